@@ -0,0 +1,283 @@
+#!/bin/bash
+# Benchmark suite: runs every workload on every kernel variant, and saves
+# what was measured as CSV and JSON.  Given the results of an earlier run,
+# reports the measures that got worse by more than a threshold.
+#
+# Usage:
+#
+#     bench/run.sh [-v "<variants>"] [-w "<workloads>"] [-p <programs dir>]
+#                  [-o <results prefix>] [-b <baseline CSV>] [-n <runs>]
+#                  [-t <simulated %>] [-T <wall %>] [-s]
+#
+# * `-v` -- variants to build and run (see `Makefile`); all by default.
+# * `-w` -- workloads to run (see `RunWorkload`); all by default.
+# * `-p` -- where the user programs are; `../userland` by default.
+# * `-o` -- results go to `<prefix>.csv` and `<prefix>.json`;
+#           `results` by default.
+# * `-b` -- compares against the CSV of an earlier run, and exits with
+#           status 1 if anything regressed.
+# * `-n` -- runs each workload this many times, keeping the shortest wall
+#           time; the simulated measures do not change from run to run.
+# * `-t` -- how much (in percent) the simulated measures (ticks, faults,
+#           swapping, disk operations) may grow before it counts as a
+#           regression; 2 by default.
+# * `-T` -- the same for the host wall time; 25 by default.
+# * `-s` -- skips building, using the `nachos-<variant>` already there.
+#
+# Each workload runs in an empty directory holding only the programs and
+# files it needs.  Workloads whose programs have not been built (there is
+# no MIPS cross compiler) are recorded as `missing`.
+#
+# Copyright (c) 2016-2021 Docentes de la Universidad Nacional de Rosario.
+# All rights reserved.  See `copyright.h` for copyright notice and
+# limitation of liability and disclaimer of warranty provisions.
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+
+VARIANTS="userprog tlb demand swap-fifo swap-clock swap-random"
+WORKLOADS="matmult sort cat cp shell memory_test_a memory_test_b memory_test_c"
+PROGRAMS_DIR=$BENCH_DIR/../userland
+PREFIX=results
+BASELINE=
+RUNS=1
+SIM_THRESHOLD=2
+WALL_THRESHOLD=25
+BUILD=1
+
+TIMEOUT=600           # Seconds a single run may take.
+BIG_FILE_SIZE=16384   # Bytes of the file that `cat` and `cp` go through.
+SHELL_COMMANDS=16     # Processes started by the `shell` workload.
+
+COLUMNS="variant,workload,status,ticks,user_ticks,system_ticks,idle_ticks"
+COLUMNS+=",wall_ms,minstr_per_s,page_faults,swap_out,swap_in"
+COLUMNS+=",disk_reads,disk_writes"
+
+while getopts "v:w:p:o:b:n:t:T:s" option; do
+    case $option in
+        v) VARIANTS=$OPTARG ;;
+        w) WORKLOADS=$OPTARG ;;
+        p) PROGRAMS_DIR=$(cd "$OPTARG" && pwd) ;;
+        o) PREFIX=$OPTARG ;;
+        b) BASELINE=$OPTARG ;;
+        n) RUNS=$OPTARG ;;
+        t) SIM_THRESHOLD=$OPTARG ;;
+        T) WALL_THRESHOLD=$OPTARG ;;
+        s) BUILD=0 ;;
+        *) echo "See the comment at the top of $0 for the options." >&2
+           exit 2 ;;
+    esac
+done
+
+# Build `nachos-<variant>`, from scratch so that no object of another
+# variant gets in.
+BuildVariant() {
+    local variant=$1
+    echo ":: Building variant $(tput bold)$variant$(tput sgr0)"
+    make -C "$BENCH_DIR" clean >/dev/null
+    make -C "$BENCH_DIR" VARIANT="$variant" depend >/dev/null 2>&1
+    if ! make -C "$BENCH_DIR" VARIANT="$variant" -j"$(nproc)" nachos \
+             >"$BENCH_DIR/build.log" 2>&1; then
+        cat "$BENCH_DIR/build.log" >&2
+        return 1
+    fi
+    rm "$BENCH_DIR/build.log"
+    mv "$BENCH_DIR/nachos" "$BENCH_DIR/nachos-$variant"
+}
+
+# Copy the given programs into the work directory; fail if any of them has
+# not been built.
+NeedPrograms() {
+    local program
+    for program in "$@"; do
+        [ -f "$PROGRAMS_DIR/$program" ] || return 1
+        cp "$PROGRAMS_DIR/$program" "$WORK_DIR/"
+    done
+}
+
+# Prepare the work directory for a workload, and say how to start it in
+# `ARGS` and what to give it on the console in `INPUT`.
+PrepareWorkload() {
+    local workload=$1
+    INPUT=/dev/null
+    case $workload in
+        matmult|sort|memory_test_a|memory_test_b|memory_test_c)
+            NeedPrograms "$workload" || return 1
+            ARGS="-x $workload"
+            ;;
+        cat|cp)
+            NeedPrograms shell halt "$workload" || return 1
+            yes "The quick brown fox jumps over the lazy dog 0123456789." \
+                | head -c $BIG_FILE_SIZE >"$WORK_DIR/big.txt"
+            if [ "$workload" = cat ]; then
+                echo "cat big.txt" >"$WORK_DIR/input"
+            else
+                echo "cp big.txt copy.txt" >"$WORK_DIR/input"
+            fi
+            echo "exit" >>"$WORK_DIR/input"
+            ARGS="-x shell"
+            INPUT=$WORK_DIR/input
+            ;;
+        shell)
+            # Many short processes, half of them in the background.
+            NeedPrograms shell halt echo || return 1
+            for i in $(seq 1 $SHELL_COMMANDS); do
+                if [ $((i % 2)) = 0 ]; then
+                    echo "&echo background $i"
+                else
+                    echo "echo foreground $i"
+                fi
+            done >"$WORK_DIR/input"
+            echo "exit" >>"$WORK_DIR/input"
+            ARGS="-x shell"
+            INPUT=$WORK_DIR/input
+            ;;
+        *)
+            echo "Unknown workload: $workload" >&2
+            return 1
+            ;;
+    esac
+}
+
+# Run a workload on a variant and print its CSV line.
+RunWorkload() {
+    local variant=$1 workload=$2
+    local nachos=$BENCH_DIR/nachos-$variant
+    local status=ok best= run start end wall
+
+    for run in $(seq 1 "$RUNS"); do
+        rm -rf "$WORK_DIR" && mkdir -p "$WORK_DIR"
+        if ! PrepareWorkload "$workload"; then
+            echo "$variant,$workload,missing,,,,,,,,,,,"
+            return
+        fi
+        start=$(date +%s%N)
+        (cd "$WORK_DIR" \
+            && timeout $TIMEOUT "$nachos" -ips $ARGS <"$INPUT" >output 2>&1)
+        local exitStatus=$?
+        end=$(date +%s%N)
+        wall=$(( (end - start) / 1000000 ))
+        if [ $exitStatus != 0 ] || ! grep -q "^Ticks:" "$WORK_DIR/output"
+        then
+            status=failed
+            cp "$WORK_DIR/output" "$BENCH_DIR/$variant-$workload.failed"
+            break
+        fi
+        if [ -z "$best" ] || [ "$wall" -lt "$best" ]; then
+            best=$wall
+        fi
+    done
+
+    if [ $status != ok ]; then
+        echo "$variant,$workload,$status,,,,,,,,,,,"
+        return
+    fi
+    awk -v prefix="$variant,$workload,ok" -v wall="$best" '
+        { gsub(",", "") }
+        /^Ticks: total/         { total = $3; idle = $5; sys = $7; user = $9 }
+        /^Speed:/               { speed = $7 }
+        /^Paging: faults/       { faults = $3 }
+        /^Swapping: save/       { out = $3 }
+        /^Swapping: recovery/   { in_ = $3 }
+        /^Disk I\/O:/           { reads = $4; writes = $6 }
+        END {
+            printf "%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s\n", prefix, total,
+                   user, sys, idle, wall, speed, faults, out, in_,
+                   reads, writes
+        }' "$WORK_DIR/output"
+}
+
+# Print the results as JSON: one object per CSV line.
+CsvToJson() {
+    awk -F, '
+        NR == 1 { for (i = 1; i <= NF; i++) name[i] = $i; next }
+        {
+            printf "%s\n  {", (NR == 2 ? "[" : ",")
+            for (i = 1; i <= NF; i++) {
+                if (i <= 3) {
+                    value = "\"" $i "\""
+                } else {
+                    value = $i == "" ? "null" : $i
+                }
+                printf "%s\"%s\": %s", (i > 1 ? ", " : ""), name[i], value
+            }
+            printf "}"
+        }
+        END { print (NR < 2 ? "[]" : "\n]") }' "$1"
+}
+
+# Print the measures in `$1` that are worse than in the baseline `$2` by
+# more than the thresholds; return 1 if there is any.
+Compare() {
+    awk -F, -v sim="$SIM_THRESHOLD" -v wall="$WALL_THRESHOLD" '
+        NR == FNR {
+            if (FNR == 1) {
+                for (i = 1; i <= NF; i++) column[$i] = i
+            } else if ($3 == "ok") {
+                base[$1 "," $2] = $0
+            }
+            next
+        }
+        FNR == 1 { next }
+        $3 != "ok" || !(($1 "," $2) in base) { next }
+        {
+            split(base[$1 "," $2], b, ",")
+            n = split("ticks page_faults swap_out swap_in disk_reads " \
+                      "disk_writes wall_ms", measures, " ")
+            for (i = 1; i <= n; i++) {
+                m = measures[i]
+                c = column[m]
+                limit = m == "wall_ms" ? wall : sim
+                if ($c > b[c] * (1 + limit / 100)) {
+                    printf "REGRESSION %s/%s: %s went from %s to %s" \
+                           " (limit +%s%%)\n", $1, $2, m, b[c], $c, limit
+                    regressions++
+                }
+            }
+        }
+        END { exit regressions > 0 }' "$2" "$1"
+}
+
+WORK_DIR=$BENCH_DIR/work
+CSV=$PREFIX.csv
+JSON=$PREFIX.json
+
+missing=0
+echo "$COLUMNS" >"$CSV"
+for variant in $VARIANTS; do
+    if [ $BUILD = 1 ] && ! BuildVariant "$variant"; then
+        echo "Could not build variant $variant." >&2
+        exit 2
+    fi
+    for workload in $WORKLOADS; do
+        line=$(RunWorkload "$variant" "$workload")
+        echo "$line" >>"$CSV"
+        case $line in
+            *,missing,*) missing=$((missing + 1)) ;;
+        esac
+        echo "$line" | awk -F, '{
+            if ($3 == "ok")
+                printf "%-12s %-14s %10s ticks %8s ms %6s faults\n",
+                       $1, $2, $4, $8, $10
+            else
+                printf "%-12s %-14s %s\n", $1, $2, $3
+        }'
+    done
+done
+rm -rf "$WORK_DIR"
+make -C "$BENCH_DIR" clean >/dev/null
+
+CsvToJson "$CSV" >"$JSON"
+echo "Results saved in $CSV and $JSON."
+if [ $missing -gt 0 ]; then
+    echo "Programs missing for $missing runs (looked in $PROGRAMS_DIR);" \
+         "build them with \`make -C userland\` or give their directory" \
+         "with -p." >&2
+fi
+
+if [ -n "$BASELINE" ]; then
+    if Compare "$CSV" "$BASELINE"; then
+        echo "No regressions against $BASELINE."
+    else
+        exit 1
+    fi
+fi
@@ -13,6 +13,9 @@
 ///    .data      -- initialized data
 ///    .bss/.sbss -- uninitialized data (should be zeroed on program startup)
 ///
+/// If the COFF file was not stripped, the procedures in its symbol table
+/// are kept at the end of the NOFF file (see `noff.h`), for the profiler.
+///
 /// Copyright (c) 1992-1993 The Regents of the University of California.
 ///               2016-2021 Docentes de la Universidad Nacional de Rosario.
 /// All rights reserved.  See `copyright.h` for copyright notice and
@@ -22,6 +25,7 @@
 #include "coff_reader.h"
 #include "coff_section.h"
 #include "noff.h"
+#include "extern/syms.h"
 #include "threads/copyright.h"
 
 #include <sys/types.h>
@@ -80,6 +84,139 @@ WriteOrDie(FILE *f, const char *buffer, size_t numBytes)
     }
 }
 
+/// Read `numBytes` starting at `offset`, into a buffer that the caller has
+/// to free.  A null character is added at the end, for string tables.
+static char *
+ReadTableOrDie(FILE *f, long offset, size_t numBytes)
+{
+    assert(f != NULL);
+
+    char *table = malloc(numBytes + 1);
+    if (table == NULL) {
+        Die("Could not allocate memory");
+    }
+    if (numBytes > 0) {
+        fseek(f, offset, SEEK_SET);
+        ReadOrDie(f, table, numBytes);
+    }
+    table[numBytes] = '\0';
+    return table;
+}
+
+static bool
+IsProcedure(const SYMR *s)
+{
+    assert(s != NULL);
+
+    return (s->st == stProc || s->st == stStaticProc) && s->sc == scText;
+}
+
+static void
+AddSymbol(noffSymbol *symbols, unsigned *n, const SYMR *s,
+          const char *strings, int numStrings)
+{
+    assert(symbols != NULL);
+    assert(n != NULL);
+    assert(s != NULL);
+    assert(strings != NULL);
+
+    if (!IsProcedure(s) || s->iss < 0 || s->iss >= numStrings) {
+        return;
+    }
+    noffSymbol *sym = &symbols[(*n)++];
+    sym->address = s->value;
+    strncpy(sym->name, &strings[s->iss], NOFF_SYMBOL_NAME_SIZE - 1);
+    sym->name[NOFF_SYMBOL_NAME_SIZE - 1] = '\0';
+}
+
+static int
+CompareSymbols(const void *a, const void *b)
+{
+    uint32_t x = ((const noffSymbol *) a)->address;
+    uint32_t y = ((const noffSymbol *) b)->address;
+    return x < y ? -1 : x > y;
+}
+
+/// Append the procedures found in the COFF symbol table to the NOFF file.
+///
+/// Global procedures are among the external symbols; static ones only
+/// appear among the local symbols of the file that defines them, which
+/// list the global ones again.  Repeated addresses are kept once.
+static void
+WriteSymbols(FILE *in, FILE *out, const coffReaderData *d)
+{
+    assert(in != NULL);
+    assert(out != NULL);
+    assert(d != NULL);
+
+#ifdef HOST_IS_BIG_ENDIAN
+    printf("WARNING: symbols are not kept on big endian hosts.\n");
+    return;
+#endif
+    if (d->fileH.symbolPtr == 0) {
+        printf("No symbol table (stripped?); profiles will not name "
+               "functions.\n");
+        return;
+    }
+
+    HDRR h;
+    fseek(in, d->fileH.symbolPtr, SEEK_SET);
+    ReadStructOrDie(in, h);
+
+    noffSymbol *symbols = calloc(h.iextMax + h.isymMax + 1,
+                                 sizeof *symbols);
+    if (symbols == NULL) {
+        Die("Could not allocate memory");
+    }
+    unsigned n = 0;
+
+    char *strings = ReadTableOrDie(in, h.cbSsExtOffset, h.issExtMax);
+    EXTR *externals = (EXTR *) ReadTableOrDie(in, h.cbExtOffset,
+                                              h.iextMax * sizeof (EXTR));
+    for (int i = 0; i < h.iextMax; i++) {
+        AddSymbol(symbols, &n, &externals[i].asym, strings, h.issExtMax);
+    }
+    free(externals);
+    free(strings);
+
+    strings = ReadTableOrDie(in, h.cbSsOffset, h.issMax);
+    SYMR *locals = (SYMR *) ReadTableOrDie(in, h.cbSymOffset,
+                                           h.isymMax * sizeof (SYMR));
+    FDR *files = (FDR *) ReadTableOrDie(in, h.cbFdOffset,
+                                        h.ifdMax * sizeof (FDR));
+    for (int i = 0; i < h.ifdMax; i++) {
+        const FDR *fd = &files[i];
+        for (int j = 0; j < fd->csym; j++) {
+            if (fd->isymBase + j >= h.isymMax || fd->issBase > h.issMax) {
+                break;
+            }
+            AddSymbol(symbols, &n, &locals[fd->isymBase + j],
+                      &strings[fd->issBase], h.issMax - fd->issBase);
+        }
+    }
+    free(files);
+    free(locals);
+    free(strings);
+
+    qsort(symbols, n, sizeof *symbols, CompareSymbols);
+    unsigned kept = 0;
+    for (unsigned i = 0; i < n; i++) {
+        if (kept == 0 || symbols[i].address != symbols[kept - 1].address) {
+            symbols[kept++] = symbols[i];
+        }
+    }
+
+    noffSymbolTrailer trailer;
+    trailer.numSymbols = kept;
+    trailer.magic      = NOFF_SYMBOLS_MAGIC;
+    if (kept > 0) {
+        WriteOrDie(out, (const char *) symbols, kept * sizeof *symbols);
+    }
+    WriteOrDie(out, (const char *) &trailer, sizeof trailer);
+    printf("Kept %u procedure symbols.\n", kept);
+    free(symbols);
+}
+
 void
 main(int argc, char *argv[])
 {
@@ -205,6 +342,9 @@ main(int argc, char *argv[])
         free(name);
     }
 
+    fseek(out, inNoffFile, SEEK_SET);
+    WriteSymbols(in, out, &d);
+
     fseek(out, 0, SEEK_SET);
     WriteOrDie(out, (const char *) &noffH, sizeof noffH);
     fclose(in);
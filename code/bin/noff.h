@@ -32,5 +32,25 @@ typedef struct noffHeader {
                              // zeroed before use.
 } noffHeader;
 
+/// Optionally, a table of the procedures in the program follows the
+/// segments, sorted by address, so that profiles and stack traces can be
+/// given in terms of functions.  It is found from the end of the file: the
+/// last bytes are a `noffSymbolTrailer`, and the `numSymbols` entries come
+/// right before it.  Loaders that do not know about it never look there.
+
+#define NOFF_SYMBOLS_MAGIC  0x5359BADF
+
+#define NOFF_SYMBOL_NAME_SIZE  28  // Longer names are cut.
+
+typedef struct noffSymbol {
+    uint32_t address;                  // Where the procedure starts.
+    char name[NOFF_SYMBOL_NAME_SIZE];  // Null-terminated.
+} noffSymbol;
+
+typedef struct noffSymbolTrailer {
+    uint32_t numSymbols;
+    uint32_t magic;       // Should be `NOFF_SYMBOLS_MAGIC`.
+} noffSymbolTrailer;
+
 
 #endif
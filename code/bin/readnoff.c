@@ -62,5 +62,23 @@ main(int argc, char *argv[])
     PrintSegment(&h.code, "Code");
     PrintSegment(&h.initData, "Initialized data");
     PrintSegment(&h.uninitData, "Uninitialized data");
+
+    // List the procedures, if `coff2noff` kept them.
+    noffSymbolTrailer t;
+    if (fseek(f, -(long) sizeof t, SEEK_END) == 0
+          && fread(&t, sizeof t, 1, f) == 1 && t.magic == NOFF_SYMBOLS_MAGIC
+          && fseek(f, -(long) (sizeof t + t.numSymbols * sizeof (noffSymbol)),
+                   SEEK_END) == 0) {
+        printf("    Symbols: %u\n", t.numSymbols);
+        noffSymbol s;
+        for (unsigned i = 0; i < t.numSymbols
+                             && fread(&s, sizeof s, 1, f) == 1; i++) {
+            s.name[NOFF_SYMBOL_NAME_SIZE - 1] = '\0';
+            printf("        0x%08X  %s\n", s.address, s.name);
+        }
+    } else {
+        printf("    Symbols: none\n");
+    }
+    fclose(f);
     return 0;
 }
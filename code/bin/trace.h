@@ -0,0 +1,70 @@
+/// Data structures defining the Nachos trace file format.
+///
+/// A trace file, written by Nachos when run with `-tr`, is a `traceHeader`
+/// followed by `numEvents` `traceEvent`s (oldest first) and then by
+/// `numNames` `traceName`s.  All fields are in host byte order.
+///
+/// Copyright (c) 2016-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_BIN_TRACE__H
+#define NACHOS_BIN_TRACE__H
+
+
+#include <stdint.h>
+
+
+#define TRACE_MAGIC    0x45435254  // "TRCE".
+#define TRACE_VERSION  1
+
+#define TRACE_NAME_SIZE  24  // Longer names are cut.
+
+/// Event types.  Unless said otherwise, `tick` is when the event happened
+/// and `thread` is the thread running at that moment.
+enum traceEventType {
+    TRACE_SWITCH = 1,   // `thread` starts running; `arg0`: previous thread.
+    TRACE_TLB_MISS,     // `arg0`: virtual address.
+    TRACE_PAGE_FAULT,   // `arg0`: virtual page, `arg1`: ticks to load it.
+    TRACE_SWAP_OUT,     // `arg0`: virtual page, `arg1`: physical page.
+    TRACE_SWAP_IN,      // `arg0`: virtual page, `arg1`: physical page.
+    TRACE_DISK_READ,    // `arg0`: sector, `arg1`: latency in ticks.
+    TRACE_DISK_WRITE,   // `arg0`: sector, `arg1`: latency in ticks.
+    TRACE_SYSCALL,      // `arg0`: system call id, `arg1`: duration.
+    TRACE_LOCK_WAIT,    // `arg0`: lock name, `arg1`: time waited.
+    TRACE_NUM_TYPES
+};
+
+/// Events with a duration are recorded when they end, but `tick` is when
+/// they began.
+
+typedef struct traceHeader {
+    uint32_t magic;      // Should be `TRACE_MAGIC`.
+    uint32_t version;    // Should be `TRACE_VERSION`.
+    uint32_t numEvents;  // Events kept in the file.
+    uint32_t numNames;   // Names following the events.
+    uint64_t lost;       // Older events overwritten in the ring buffer.
+} traceHeader;
+
+typedef struct traceEvent {
+    uint64_t tick;
+    uint32_t type;    // A `traceEventType`.
+    uint32_t thread;  // Thread id; see `traceName`.
+    uint32_t arg0;
+    uint32_t arg1;
+} traceEvent;
+
+enum traceNameKind {
+    TRACE_NAME_THREAD = 1,
+    TRACE_NAME_LOCK
+};
+
+/// Gives a name to a thread or lock id.
+typedef struct traceName {
+    uint32_t kind;  // A `traceNameKind`.
+    uint32_t id;
+    char name[TRACE_NAME_SIZE];  // Null-terminated.
+} traceName;
+
+
+#endif
@@ -0,0 +1,245 @@
+/// Program that converts a Nachos trace file (see `trace.h`) into the JSON
+/// trace format read by the Chrome trace viewer (`chrome://tracing`) and by
+/// Perfetto (`ui.perfetto.dev`).
+///
+/// One tick is shown as one microsecond.  Each Nachos thread gets a track,
+/// with the intervals in which it was running, its system calls, page
+/// faults and disk requests, and marks for TLB misses and swapping.
+///
+/// Copyright (c) 2016-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "trace.h"
+
+#define IN_ASM  // Only the system call numbers.
+#include "userprog/syscall.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+static const struct {
+    unsigned id;
+    const char *name;
+} SYSCALL_NAMES[] = {
+    { SC_HALT, "Halt" },     { SC_EXIT, "Exit" },     { SC_EXEC, "Exec" },
+    { SC_JOIN, "Join" },     { SC_FORK, "Fork" },     { SC_YIELD, "Yield" },
+    { SC_CREATE, "Create" }, { SC_REMOVE, "Remove" }, { SC_OPEN, "Open" },
+    { SC_CLOSE, "Close" },   { SC_READ, "Read" },     { SC_WRITE, "Write" },
+    { SC_PS, "Ps" },         { SC_LS, "Ls" },         { SC_CD, "Cd" },
+    { SC_BIND, "Bind" },     { SC_SEND, "Send" },     { SC_RECEIVE, "Receive" },
+    { SC_SHARED_REGION, "SharedRegion" },
+    { SC_CONSOLE_MODE, "ConsoleMode" },
+};
+
+static traceName *names;
+static unsigned numNames;
+static int first = 1;
+
+static const char *
+NameOf(unsigned kind, unsigned id)
+{
+    for (unsigned i = 0; i < numNames; i++) {
+        if (names[i].kind == kind && names[i].id == id) {
+            return names[i].name;
+        }
+    }
+    return NULL;
+}
+
+static const char *
+SyscallName(unsigned id)
+{
+    for (unsigned i = 0; i < sizeof SYSCALL_NAMES / sizeof *SYSCALL_NAMES;
+         i++) {
+        if (SYSCALL_NAMES[i].id == id) {
+            return SYSCALL_NAMES[i].name;
+        }
+    }
+    return "unknown";
+}
+
+static void
+PrintString(const char *s)
+{
+    putchar('"');
+    for (; *s != '\0'; s++) {
+        if (*s == '"' || *s == '\\') {
+            putchar('\\');
+        }
+        if ((unsigned char) *s >= ' ') {
+            putchar(*s);
+        }
+    }
+    putchar('"');
+}
+
+/// Start a new JSON event; the caller prints the `args` object and the
+/// closing brace.
+static void
+BeginEvent(const char *name, char phase, unsigned thread, uint64_t tick)
+{
+    printf(first ? "\n" : ",\n");
+    first = 0;
+    printf("{\"name\":");
+    PrintString(name);
+    printf(",\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"ts\":%llu",
+           phase, thread, (unsigned long long) tick);
+}
+
+static void
+PrintSlice(const char *name, unsigned thread, uint64_t tick, uint64_t dur,
+           const char *argName, unsigned arg)
+{
+    BeginEvent(name, 'X', thread, tick);
+    printf(",\"dur\":%llu,\"args\":{\"%s\":%u}}",
+           (unsigned long long) dur, argName, arg);
+}
+
+static void
+PrintInstant(const char *name, unsigned thread, uint64_t tick,
+             const char *argName, unsigned arg,
+             const char *argName2, unsigned arg2)
+{
+    BeginEvent(name, 'i', thread, tick);
+    printf(",\"s\":\"t\",\"args\":{\"%s\":%u", argName, arg);
+    if (argName2 != NULL) {
+        printf(",\"%s\":%u", argName2, arg2);
+    }
+    printf("}}");
+}
+
+int
+main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <trace file> > <JSON file>\n", argv[0]);
+        return 1;
+    }
+
+    const char *path = argv[1];
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    traceHeader header;
+    if (fread(&header, sizeof header, 1, f) != 1
+          || header.magic != TRACE_MAGIC || header.version != TRACE_VERSION) {
+        fprintf(stderr, "%s: not a Nachos trace file.\n", path);
+        return 1;
+    }
+    traceEvent *events = malloc(sizeof *events * (header.numEvents + 1));
+    names = malloc(sizeof *names * (header.numNames + 1));
+    if (events == NULL || names == NULL
+          || fread(events, sizeof *events, header.numEvents, f)
+               != header.numEvents
+          || fread(names, sizeof *names, header.numNames, f)
+               != header.numNames) {
+        fprintf(stderr, "%s: truncated trace file.\n", path);
+        return 1;
+    }
+    numNames = header.numNames;
+    fclose(f);
+
+    printf("{\"displayTimeUnit\":\"ns\",\"otherData\":{\"lostEvents\":%llu},"
+           "\"traceEvents\":[", (unsigned long long) header.lost);
+
+    // Name the tracks.
+    for (unsigned i = 0; i < numNames; i++) {
+        if (names[i].kind != TRACE_NAME_THREAD) {
+            continue;
+        }
+        names[i].name[TRACE_NAME_SIZE - 1] = '\0';
+        printf(first ? "\n" : ",\n");
+        first = 0;
+        printf("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+               "\"tid\":%u,\"args\":{\"name\":", names[i].id);
+        PrintString(names[i].name);
+        printf("}}");
+    }
+
+    // Switches give the intervals each thread was running.  The first one
+    // starts with the oldest event kept.
+    int running = 0;
+    unsigned runningThread = 0;
+    uint64_t runningSince = 0;
+    uint64_t last = 0;
+    char name[64];
+
+    for (unsigned i = 0; i < header.numEvents; i++) {
+        traceEvent *e = &events[i];
+        uint64_t end = e->tick;
+
+        switch (e->type) {
+            case TRACE_SWITCH:
+                if (!running) {
+                    runningThread = e->arg0;
+                    runningSince  = events[0].tick;
+                }
+                PrintSlice("running", runningThread, runningSince,
+                           e->tick - runningSince, "next", e->thread);
+                running = 1;
+                runningThread = e->thread;
+                runningSince  = e->tick;
+                break;
+            case TRACE_TLB_MISS:
+                PrintInstant("TLB miss", e->thread, e->tick,
+                             "vaddr", e->arg0, NULL, 0);
+                break;
+            case TRACE_PAGE_FAULT:
+                PrintSlice("page fault", e->thread, e->tick, e->arg1,
+                           "vpn", e->arg0);
+                end += e->arg1;
+                break;
+            case TRACE_SWAP_OUT:
+            case TRACE_SWAP_IN:
+                PrintInstant(e->type == TRACE_SWAP_OUT ? "swap out"
+                                                       : "swap in",
+                             e->thread, e->tick,
+                             "vpn", e->arg0, "frame", e->arg1);
+                break;
+            case TRACE_DISK_READ:
+            case TRACE_DISK_WRITE:
+                PrintSlice(e->type == TRACE_DISK_READ ? "disk read"
+                                                      : "disk write",
+                           e->thread, e->tick, e->arg1, "sector", e->arg0);
+                end += e->arg1;
+                break;
+            case TRACE_SYSCALL:
+                snprintf(name, sizeof name, "%s", SyscallName(e->arg0));
+                PrintSlice(name, e->thread, e->tick, e->arg1,
+                           "id", e->arg0);
+                end += e->arg1;
+                break;
+            case TRACE_LOCK_WAIT: {
+                const char *lock = NameOf(TRACE_NAME_LOCK, e->arg0);
+                snprintf(name, sizeof name, "wait for %s",
+                         lock != NULL ? lock : "lock");
+                PrintSlice(name, e->thread, e->tick, e->arg1,
+                           "lock", e->arg0);
+                end += e->arg1;
+                break;
+            }
+            default:
+                fprintf(stderr, "Unknown event type %u, skipped.\n",
+                        e->type);
+                break;
+        }
+        if (end > last) {
+            last = end;
+        }
+    }
+    if (running) {
+        PrintSlice("running", runningThread, runningSince,
+                   last - runningSince, "next", runningThread);
+    }
+    printf("\n]}\n");
+
+    free(events);
+    free(names);
+    return 0;
+}
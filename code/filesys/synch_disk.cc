@@ -14,6 +14,7 @@
 
 
 #include "synch_disk.hh"
+#include "threads/system.hh"
 
 
 /// Disk interrupt handler.  Need this to be a C routine, because C++ cannot
@@ -57,8 +58,13 @@ SynchDisk::ReadSector(int sectorNumber, char *data)
     ASSERT(data != nullptr);
 
     lock->Acquire();  // Only one disk I/O at a time.
+    unsigned long start = stats->totalTicks;
     disk->ReadRequest(sectorNumber, data);
     semaphore->P();   // Wait for interrupt.
+    currentThread->usage.sectorsRead++;
+    if (tracer != nullptr) {
+        tracer->RecordSince(TRACE_DISK_READ, start, sectorNumber);
+    }
     lock->Release();
 }
 
@@ -73,8 +79,13 @@ SynchDisk::WriteSector(int sectorNumber, const char *data)
     ASSERT(data != nullptr);
 
     lock->Acquire();  // only one disk I/O at a time
+    unsigned long start = stats->totalTicks;
     disk->WriteRequest(sectorNumber, data);
     semaphore->P();   // wait for interrupt
+    currentThread->usage.sectorsWritten++;
+    if (tracer != nullptr) {
+        tracer->RecordSince(TRACE_DISK_WRITE, start, sectorNumber);
+    }
     lock->Release();
 }
 
@@ -20,18 +20,7 @@
 
 Debug::Debug()
 {
-    flags = "";
-}
-
-bool
-Debug::IsEnabled(char flag) const
-{
-    if (flags != nullptr) {
-        return strchr(flags, flag) != 0
-               || strchr(flags, '+') != 0;
-    } else {
-        return false;
-    }
+    SetFlags("");
 }
 
 const char *
@@ -44,6 +33,14 @@ void
 Debug::SetFlags(const char *new_flags)
 {
     flags = new_flags;
+
+    bool all = flags != nullptr && strchr(flags, '+') != nullptr;
+    for (unsigned i = 0; i < sizeof enabled; i++) {
+        enabled[i] = all;
+    }
+    for (const char *f = flags; f != nullptr && *f != '\0'; f++) {
+        enabled[(unsigned char) *f] = true;
+    }
 }
 
 void
@@ -0,0 +1,207 @@
+/// Data structures to manage intrusive lists.
+///
+/// Unlike `List`, an intrusive list does not allocate anything: the links
+/// live inside the items themselves, in a `ListLink` member that the list
+/// is told about through a pointer to member.  Putting an item on the list
+/// and taking it off are therefore a handful of pointer assignments, and
+/// removing an item from the middle of the list takes constant time.
+///
+/// The price is that an item can only be on one list per `ListLink` member
+/// at a time.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_LIB_INTRUSIVELIST__HH
+#define NACHOS_LIB_INTRUSIVELIST__HH
+
+
+#include "utility.hh"
+
+
+/// Links to embed in every item that can be put on an `IntrusiveList`.
+template <class Item>
+class ListLink {
+public:
+
+    ListLink();
+
+    Item *next;   ///< Next item on the list, null if this is the last.
+    Item *prev;   ///< Previous item on the list, null if this is the first.
+    bool linked;  ///< Is the item on some list?
+};
+
+/// The following class defines a doubly linked list of `Item`s, chained
+/// through their `Link` member.
+///
+/// For example, `IntrusiveList<Thread, &Thread::readyLink>`.
+template <class Item, ListLink<Item> Item::*Link>
+class IntrusiveList {
+public:
+
+    /// Initialize the list.
+    IntrusiveList();
+
+    /// Put item at the beginning of the list.
+    void Prepend(Item *item);
+
+    /// Put item at the end of the list.
+    void Append(Item *item);
+
+    /// Get the item on the front of the list, without removing it.
+    Item *Head() const;
+
+    /// Take item off the front of the list.
+    Item *Pop();
+
+    /// Take `item` off the list, wherever it is.
+    void Remove(Item *item);
+
+    /// Apply `func` to all elements in list.
+    void Apply(void (*func)(Item *)) const;
+
+    /// Is the list empty?
+    bool IsEmpty() const;
+
+private:
+
+    Item *first;  ///< Head of the list, null if list is empty.
+    Item *last;   ///< Last element of list.
+};
+
+template <class Item>
+ListLink<Item>::ListLink()
+{
+    next   = nullptr;
+    prev   = nullptr;
+    linked = false;
+}
+
+/// Initialize a list, empty to start with.
+template <class Item, ListLink<Item> Item::*Link>
+IntrusiveList<Item, Link>::IntrusiveList()
+{
+    first = last = nullptr;
+}
+
+/// Put an `item` on the front of the list.
+///
+/// The item must not be on another list through the same link.
+template <class Item, ListLink<Item> Item::*Link>
+void
+IntrusiveList<Item, Link>::Prepend(Item *item)
+{
+    ASSERT(item != nullptr);
+
+    ListLink<Item> &link = item->*Link;
+    ASSERT(!link.linked);
+
+    link.linked = true;
+    link.prev   = nullptr;
+    link.next   = first;
+    if (first == nullptr) {
+        last = item;
+    } else {
+        (first->*Link).prev = item;
+    }
+    first = item;
+}
+
+/// Put an `item` at the end of the list.
+///
+/// The item must not be on another list through the same link.
+template <class Item, ListLink<Item> Item::*Link>
+void
+IntrusiveList<Item, Link>::Append(Item *item)
+{
+    ASSERT(item != nullptr);
+
+    ListLink<Item> &link = item->*Link;
+    ASSERT(!link.linked);
+
+    link.linked = true;
+    link.next   = nullptr;
+    link.prev   = last;
+    if (last == nullptr) {
+        first = item;
+    } else {
+        (last->*Link).next = item;
+    }
+    last = item;
+}
+
+/// Returns the first item, null if the list is empty.
+template <class Item, ListLink<Item> Item::*Link>
+Item *
+IntrusiveList<Item, Link>::Head() const
+{
+    return first;
+}
+
+/// Remove the first item from the front of the list.
+///
+/// Returns the removed item, null if nothing on the list.
+template <class Item, ListLink<Item> Item::*Link>
+Item *
+IntrusiveList<Item, Link>::Pop()
+{
+    Item *item = first;
+    if (item != nullptr) {
+        Remove(item);
+    }
+    return item;
+}
+
+/// Unlink `item`, which must be on this list.
+template <class Item, ListLink<Item> Item::*Link>
+void
+IntrusiveList<Item, Link>::Remove(Item *item)
+{
+    ASSERT(item != nullptr);
+
+    ListLink<Item> &link = item->*Link;
+    ASSERT(link.linked);
+
+    if (link.prev == nullptr) {
+        ASSERT(first == item);
+        first = link.next;
+    } else {
+        (link.prev->*Link).next = link.next;
+    }
+    if (link.next == nullptr) {
+        ASSERT(last == item);
+        last = link.prev;
+    } else {
+        (link.next->*Link).prev = link.prev;
+    }
+    link.next   = nullptr;
+    link.prev   = nullptr;
+    link.linked = false;
+}
+
+/// Apply a function to each item on the list.
+///
+/// `func` must not take the item off the list.
+template <class Item, ListLink<Item> Item::*Link>
+void
+IntrusiveList<Item, Link>::Apply(void (*func)(Item *)) const
+{
+    ASSERT(func != nullptr);
+
+    for (Item *item = first; item != nullptr; item = (item->*Link).next) {
+        func(item);
+    }
+}
+
+/// Returns true if the list is empty (has no items).
+template <class Item, ListLink<Item> Item::*Link>
+bool
+IntrusiveList<Item, Link>::IsEmpty() const
+{
+    return first == nullptr;
+}
+
+
+#endif
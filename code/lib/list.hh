@@ -14,6 +14,8 @@
 
 #include "utility.hh"
 
+#include <stddef.h>
+
 
 /// The following class defines a “list element” -- which is used to keep
 /// track of one item on a list.
@@ -30,6 +32,17 @@ public:
     ListElement *next;  ///< Next element on list, null if this is the last.
     int key;            ///< Priority, for a sorted list.
     Item item;          ///< Item on the list.
+
+    /// Elements are taken from and given back to a pool shared by every
+    /// `List<Item>`, so that once the pool has grown to the largest number
+    /// of elements ever in use, lists no longer go to the global heap.
+    static void *operator new(size_t size);
+    static void operator delete(void *p);
+
+private:
+
+    /// Unused elements, chained through `next`.
+    static ListElement *freeElements;
 };
 
 /// The following class defines a “list” -- a singly linked list of list
@@ -98,6 +111,35 @@ ListElement<Item>::ListElement(Item anItem, int sortKey)
      next = nullptr;  // Assume we will put it at the end of the list.
 }
 
+template <class Item>
+ListElement<Item> *ListElement<Item>::freeElements = nullptr;
+
+template <class Item>
+void *
+ListElement<Item>::operator new(size_t size)
+{
+    ASSERT(size == sizeof (ListElement));
+
+    ListElement *element = freeElements;
+    if (element == nullptr) {
+        return ::operator new(size);
+    }
+    freeElements = element->next;
+    return element;
+}
+
+template <class Item>
+void
+ListElement<Item>::operator delete(void *p)
+{
+    if (p == nullptr) {
+        return;
+    }
+    ListElement *element = static_cast<ListElement *>(p);
+    element->next = freeElements;
+    freeElements = element;
+}
+
 /// Initialize a list, empty to start with.
 ///
 /// Elements can now be added to the list.
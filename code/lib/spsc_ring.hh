@@ -0,0 +1,209 @@
+/// A bounded queue for exactly one producer and one consumer.
+///
+/// Meant for handing data from an interrupt handler to a kernel thread (or
+/// the other way around) without locks: neither side ever blocks, so the
+/// handler side can use it with interrupts disabled, and each index is only
+/// written by one of the two sides.  Whoever needs to wait for data or for
+/// room does so with something else (usually a `Semaphore`), after the
+/// ring says it is empty or full.
+///
+/// Items are copied in and out; for big items, `Reserve`/`Commit` and
+/// `Front`/`Discard` give access to the slots in place.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_LIB_SPSCRING__HH
+#define NACHOS_LIB_SPSCRING__HH
+
+
+#include "utility.hh"
+
+
+/// `CAPACITY` must be a power of two.
+template <class Item, unsigned CAPACITY>
+class SpscRing {
+    static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0,
+                  "the capacity of a ring must be a power of two");
+public:
+
+    /// Initialize an empty ring.
+    SpscRing();
+
+    /// Producer: append `item`.  Returns false if the ring is full.
+    bool Push(const Item &item);
+
+    /// Producer: append as many of the `n` `items` as fit, all made
+    /// visible at once.  Returns how many were appended.
+    unsigned PushN(const Item *items, unsigned n);
+
+    /// Producer: get the slot the next `Push` would fill, or null if the
+    /// ring is full.  It becomes visible to the consumer with `Commit`.
+    Item *Reserve();
+    void Commit();
+
+    /// Consumer: take the oldest item into `item`.  Returns false if the
+    /// ring is empty.
+    bool Pop(Item *item);
+
+    /// Consumer: take up to `n` of the oldest items into `items`, freeing
+    /// their slots at once.  Returns how many were taken.
+    unsigned PopN(Item *items, unsigned n);
+
+    /// Consumer: get the oldest item without taking it, or null if the
+    /// ring is empty.  `Discard` takes it.
+    Item *Front();
+    void Discard();
+
+    bool IsEmpty() const;
+    bool IsFull() const;
+
+    /// Number of items in the ring.  Exact only for the caller's own side.
+    unsigned Size() const;
+
+private:
+
+    Item slots[CAPACITY];
+
+    /// Free-running counters; slot `n % CAPACITY` holds item number `n`.
+    /// `head` is only written by the consumer, `tail` by the producer.
+    unsigned head;
+    unsigned tail;
+};
+
+
+template <class Item, unsigned CAPACITY>
+SpscRing<Item, CAPACITY>::SpscRing()
+{
+    head = tail = 0;
+}
+
+template <class Item, unsigned CAPACITY>
+bool
+SpscRing<Item, CAPACITY>::Push(const Item &item)
+{
+    Item *slot = Reserve();
+    if (slot == nullptr) {
+        return false;
+    }
+    *slot = item;
+    Commit();
+    return true;
+}
+
+template <class Item, unsigned CAPACITY>
+unsigned
+SpscRing<Item, CAPACITY>::PushN(const Item *items, unsigned n)
+{
+    ASSERT(items != nullptr || n == 0);
+
+    unsigned used = tail - __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+    unsigned room = CAPACITY - used;
+    if (n > room) {
+        n = room;
+    }
+    for (unsigned i = 0; i < n; i++) {
+        slots[(tail + i) % CAPACITY] = items[i];
+    }
+    __atomic_store_n(&tail, tail + n, __ATOMIC_RELEASE);
+    return n;
+}
+
+template <class Item, unsigned CAPACITY>
+Item *
+SpscRing<Item, CAPACITY>::Reserve()
+{
+    unsigned h = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+    if (tail - h == CAPACITY) {
+        return nullptr;
+    }
+    return &slots[tail % CAPACITY];
+}
+
+/// Publish the slot obtained from `Reserve`.
+template <class Item, unsigned CAPACITY>
+void
+SpscRing<Item, CAPACITY>::Commit()
+{
+    ASSERT(tail - head < CAPACITY);
+    __atomic_store_n(&tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+template <class Item, unsigned CAPACITY>
+bool
+SpscRing<Item, CAPACITY>::Pop(Item *item)
+{
+    ASSERT(item != nullptr);
+
+    Item *slot = Front();
+    if (slot == nullptr) {
+        return false;
+    }
+    *item = *slot;
+    Discard();
+    return true;
+}
+
+template <class Item, unsigned CAPACITY>
+unsigned
+SpscRing<Item, CAPACITY>::PopN(Item *items, unsigned n)
+{
+    ASSERT(items != nullptr || n == 0);
+
+    unsigned available = __atomic_load_n(&tail, __ATOMIC_ACQUIRE) - head;
+    if (n > available) {
+        n = available;
+    }
+    for (unsigned i = 0; i < n; i++) {
+        items[i] = slots[(head + i) % CAPACITY];
+    }
+    __atomic_store_n(&head, head + n, __ATOMIC_RELEASE);
+    return n;
+}
+
+template <class Item, unsigned CAPACITY>
+Item *
+SpscRing<Item, CAPACITY>::Front()
+{
+    unsigned t = __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+    if (t == head) {
+        return nullptr;
+    }
+    return &slots[head % CAPACITY];
+}
+
+/// Free the slot obtained from `Front`.
+template <class Item, unsigned CAPACITY>
+void
+SpscRing<Item, CAPACITY>::Discard()
+{
+    ASSERT(head != tail);
+    __atomic_store_n(&head, head + 1, __ATOMIC_RELEASE);
+}
+
+template <class Item, unsigned CAPACITY>
+bool
+SpscRing<Item, CAPACITY>::IsEmpty() const
+{
+    return Size() == 0;
+}
+
+template <class Item, unsigned CAPACITY>
+bool
+SpscRing<Item, CAPACITY>::IsFull() const
+{
+    return Size() == CAPACITY;
+}
+
+template <class Item, unsigned CAPACITY>
+unsigned
+SpscRing<Item, CAPACITY>::Size() const
+{
+    return __atomic_load_n(&tail, __ATOMIC_ACQUIRE)
+           - __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+}
+
+
+#endif
@@ -66,8 +66,19 @@ typedef void (*VoidNoArgFunctionPtr)();
 /// Global object for debug output.
 extern Debug debug;
 
-#define DEBUG(...)  (debug.Print)(__FILE__, __LINE__, __func__, __VA_ARGS__)
-#define DEBUG_CONT  (debug.PrintCont)
+/// Is `flag` compiled in and enabled?  Use it to guard debugging code
+/// other than `DEBUG` messages.
+#define DEBUG_ENABLED(flag)  (!DEBUG_REMOVED(flag) && debug.IsEnabled(flag))
+
+/// Print a debug message, see `Debug::Print`.  Nothing else is evaluated
+/// unless `flag` is enabled.
+#define DEBUG(flag, ...)                                                    \
+    (DEBUG_ENABLED(flag)                                                    \
+     ? (debug.Print)(__FILE__, __LINE__, __func__, flag, __VA_ARGS__)       \
+     : (void) 0)
+
+#define DEBUG_CONT(flag, ...)                                               \
+    (DEBUG_ENABLED(flag) ? (debug.PrintCont)(flag, __VA_ARGS__) : (void) 0)
 
 
 #endif
@@ -72,7 +72,9 @@ Console::Console(const char *readFile, const char *writeFile,
     readHandler  = readAvail;
     handlerArg   = callArg;
     putBusy      = false;
+    putCount     = 0;
     incoming     = EOF;
+    endOfInput   = false;
 
     // Start polling for incoming packets.
     interrupt->Schedule(ConsoleReadPoll, this,
@@ -82,6 +84,7 @@ Console::Console(const char *readFile, const char *writeFile,
 /// Clean up console emulation.
 Console::~Console()
 {
+    interrupt->UnwatchInput(readFileNo);
     if (readFileNo != 0) {
         SystemDep::Close(readFileNo);
     }
@@ -97,22 +100,41 @@ Console::~Console()
 /// character has been grabbed out of the buffer by the Nachos kernel).
 /// Invoke the “read” interrupt handler, once the character has been put into
 /// the buffer.
+///
+/// While nothing is typed, polling stops: the interrupt simulation watches
+/// the file instead, and calls back when a character comes.
     void
 Console::CheckCharAvail()
 {
     char c;
 
+    if (endOfInput) {  // Nothing else will come; stop polling.
+        return;
+    }
+
+    // Wait for something to be typed.
+    if (incoming == EOF && !SystemDep::PollFile(readFileNo)) {
+        interrupt->WatchInput(readFileNo, ConsoleReadPoll, this,
+                              CONSOLE_READ_INT);
+        return;
+    }
+
     // Schedule the next time to poll for a packet.
     interrupt->Schedule(ConsoleReadPoll, this,
             CONSOLE_TIME, CONSOLE_READ_INT);
 
-    // Do nothing if character is already buffered, or none to be read.
-    if (incoming != EOF || !SystemDep::PollFile(readFileNo)) {
+    // Do nothing if character is already buffered.
+    if (incoming != EOF) {
         return;
     }
 
-    // Otherwise, read character and tell user about it.
-    SystemDep::Read(readFileNo, &c, sizeof c);
+    // Otherwise, read character and tell user about it.  Nothing to read
+    // although the file was ready means the end of the file.
+    if (SystemDep::ReadPartial(readFileNo, &c, sizeof c) <= 0) {
+        endOfInput = true;
+        (*readHandler)(handlerArg);
+        return;
+    }
     incoming = c;
     stats->numConsoleCharsRead++;
     (*readHandler)(handlerArg);
@@ -124,7 +146,7 @@ void
 Console::WriteDone()
 {
     putBusy = false;
-    stats->numConsoleCharsWritten++;
+    stats->numConsoleCharsWritten += putCount;
     (*writeHandler)(handlerArg);
 }
 
@@ -139,14 +161,33 @@ Console::GetChar()
     return ch;
 }
 
+bool
+Console::AtEndOfInput() const
+{
+    return endOfInput;
+}
+
 /// Write a character to the simulated display, schedule an interrupt to
 /// occur in the future, and return.
 void
 Console::PutChar(char ch)
 {
+    PutBuffer(&ch, 1);
+}
+
+/// Like `PutChar`, but for a burst of characters.  The display is no
+/// faster: the interrupt comes after `CONSOLE_TIME` for each of them.  What
+/// is saved is an interrupt per character to whoever has many to write.
+void
+Console::PutBuffer(const char *buffer, unsigned size)
+{
+    ASSERT(buffer != nullptr);
+    ASSERT(size > 0 && size <= CONSOLE_BURST_SIZE);
     ASSERT(!putBusy);
-    SystemDep::WriteFile(writeFileNo, &ch, sizeof (char));
-    putBusy = true;
+
+    SystemDep::WriteFile(writeFileNo, buffer, size);
+    putBusy  = true;
+    putCount = size;
     interrupt->Schedule(ConsoleWriteDone, this,
-                        CONSOLE_TIME, CONSOLE_WRITE_INT);
+                        CONSOLE_TIME * size, CONSOLE_WRITE_INT);
 }
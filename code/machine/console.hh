@@ -27,6 +27,10 @@
 #include "lib/utility.hh"
 
 
+/// How many characters can be handed to the display in one go (see
+/// `PutBuffer`).
+const unsigned CONSOLE_BURST_SIZE = 64;
+
 /// The following class defines a hardware console device.
 ///
 /// Input and output to the device is simulated by reading and writing to
@@ -53,11 +57,23 @@ public:
     /// `writeHandler` is called when the I/O completes.
     void PutChar(char ch);
 
+    /// Write `size` characters, at most `CONSOLE_BURST_SIZE`, to the
+    /// console display, and return immediately.  The display still takes
+    /// `CONSOLE_TIME` per character, but `writeHandler` is called only
+    /// once, when all of them are out.
+    void PutBuffer(const char *buffer, unsigned size);
+
     /// Poll the console input.  If a char is available, return it.
     /// Otherwise, return EOF.  `readHandler` is called whenever there is a
     /// char to be gotten.
     char GetChar();
 
+    /// Has the input file been read to the end?
+    ///
+    /// When that happens `readHandler` is called one last time, with no
+    /// character to get, and the console stops polling its input.
+    bool AtEndOfInput() const;
+
     // Internal emulation routines -- DO NOT call these.
     // Internal routines to signal I/O completion.
 
@@ -74,8 +90,10 @@ public:
     void *handlerArg;  ///< argument to be passed to the interrupt handlers.
     bool putBusy;  ///< Is a `PutChar` operation in progress?  If so, you
                    ///< cannot do another one!
+    unsigned putCount;  ///< Characters in the transfer in progress.
     char incoming;  ///< Contains the character to be read, if there is one
                     ///< available.  Otherwise contains EOF.
+    bool endOfInput;  ///< Was the end of `readFileNo` reached?
 };
 
 
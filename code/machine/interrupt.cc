@@ -22,6 +22,7 @@
 
 #include "interrupt.hh"
 #include "threads/system.hh"
+#include "threads/lock.hh"
 
 #include <limits.h>
 #include <stdio.h>
@@ -32,7 +33,7 @@
 static const char *INT_LEVEL_NAMES[] = { "disabled", "enabled" };
 static const char *INT_TYPE_NAMES[]  = {
     "timer", "disk", "console write", "console read",
-    "network send", "network recv"
+    "network send", "network recv", "transport timeout", "wait timeout"
 };
 
 static inline bool
@@ -63,28 +64,173 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, void *param,
     handler = func;
     arg     = param;
     when    = time;
+    order   = 0;
     type    = kind;
 }
 
+static const unsigned INITIAL_PENDING_CAPACITY = 16;
+
+PendingQueue::PendingQueue()
+{
+    capacity  = INITIAL_PENDING_CAPACITY;
+    heap      = new PendingInterrupt *[capacity];
+    size      = 0;
+    nextOrder = 0;
+}
+
+PendingQueue::~PendingQueue()
+{
+    for (unsigned i = 0; i < size; i++) {
+        delete heap[i];
+    }
+    delete [] heap;
+}
+
+bool
+PendingQueue::Before(const PendingInterrupt *a, const PendingInterrupt *b)
+{
+    return a->when < b->when || (a->when == b->when && a->order < b->order);
+}
+
+void
+PendingQueue::SiftUp(unsigned i)
+{
+    PendingInterrupt *pend = heap[i];
+    while (i > 0) {
+        unsigned parent = (i - 1) / 2;
+        if (!Before(pend, heap[parent])) {
+            break;
+        }
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = pend;
+}
+
+void
+PendingQueue::SiftDown(unsigned i)
+{
+    PendingInterrupt *pend = heap[i];
+    for (;;) {
+        unsigned child = 2 * i + 1;
+        if (child >= size) {
+            break;
+        }
+        if (child + 1 < size && Before(heap[child + 1], heap[child])) {
+            child++;
+        }
+        if (!Before(heap[child], pend)) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = pend;
+}
+
+void
+PendingQueue::Insert(PendingInterrupt *pend)
+{
+    ASSERT(pend != nullptr);
+
+    if (size == capacity) {
+        PendingInterrupt **bigger = new PendingInterrupt *[2 * capacity];
+        for (unsigned i = 0; i < size; i++) {
+            bigger[i] = heap[i];
+        }
+        delete [] heap;
+        heap = bigger;
+        capacity *= 2;
+    }
+    pend->order = nextOrder++;
+    heap[size] = pend;
+    SiftUp(size++);
+}
+
+PendingInterrupt *
+PendingQueue::Head() const
+{
+    return size == 0 ? nullptr : heap[0];
+}
+
+PendingInterrupt *
+PendingQueue::Pop()
+{
+    if (size == 0) {
+        return nullptr;
+    }
+    PendingInterrupt *first = heap[0];
+    heap[0] = heap[--size];
+    if (size > 0) {
+        SiftDown(0);
+    }
+    return first;
+}
+
+bool
+PendingQueue::IsEmpty() const
+{
+    return size == 0;
+}
+
+unsigned
+PendingQueue::Size() const
+{
+    return size;
+}
+
+/// Subtracting the same amount from every key keeps the heap ordered.
+void
+PendingQueue::Rebase(unsigned long ticks)
+{
+    for (unsigned i = 0; i < size; i++) {
+        heap[i]->when -= ticks;
+    }
+}
+
+void
+PendingQueue::Apply(void (*func)(PendingInterrupt *)) const
+{
+    ASSERT(func != nullptr);
+
+    for (unsigned i = 0; i < size; i++) {
+        func(heap[i]);
+    }
+}
+
 /// Initialize the simulation of hardware device interrupts.
 ///
 /// Interrupts start disabled, with no interrupts pending, etc.
 Interrupt::Interrupt()
 {
     level         = INT_OFF;
-    pending       = new List<PendingInterrupt *>;
+    nextDue       = ULONG_MAX;
     inHandler     = false;
     yieldOnReturn = false;
     status        = SYSTEM_MODE;
+    interruptedStatus = SYSTEM_MODE;
+    numArmed       = 0;
+    nextInputCheck = 0;
+    for (unsigned i = 0; i < MAX_INPUT_WATCHES; i++) {
+        watches[i].fd    = -1;
+        watches[i].armed = false;
+    }
 }
 
 /// De-allocate the data structures needed by the interrupt simulation.
+///
+/// Interrupts still pending are freed by `pending`'s destructor.
 Interrupt::~Interrupt()
+{}
+
+void
+Interrupt::UpdateNextDue()
 {
-    while (!pending->IsEmpty()) {
-        delete pending->Pop();
+    PendingInterrupt *first = pending.Head();
+    nextDue = first == nullptr ? ULONG_MAX : first->when;
+    if (numArmed > 0 && nextInputCheck < nextDue) {
+        nextDue = nextInputCheck;
     }
-    delete pending;
 }
 
 /// Change interrupts to be enabled or disabled, without advancing the
@@ -143,6 +289,9 @@ Interrupt::Enable()
 /// Two things can cause `OneTick` to be called:
 /// * interrupts are re-enabled;
 /// * a user instruction is executed.
+///
+/// Most ticks nothing is due, which is found out by comparing against the
+/// cached `nextDue`, without looking at the pending queue.
 void
 Interrupt::OneTick()
 {
@@ -158,16 +307,23 @@ Interrupt::OneTick()
     }
     DEBUG('i', "== Tick %u ==\n", stats->totalTicks);
 
+    if (stats->totalTicks < nextDue && !yieldOnReturn) {
+        return;
+    }
+
     // Check any pending interrupts are now ready to fire.
     ChangeLevel(INT_ON, INT_OFF);  // First, turn off interrupts (interrupt
                                    // handlers run with interrupts disabled).
+    if (numArmed > 0 && stats->totalTicks >= nextInputCheck) {
+        CheckInput(0);             // Has any device got input meanwhile?
+    }
     while (CheckIfDue(false)) {}   // Check for pending interrupts.
     ChangeLevel(INT_OFF, INT_ON);  // Re-enable interrupts.
     if (yieldOnReturn) {           // If the timer device handler asked for a
                                    // context switch, ok to do it now.
         yieldOnReturn = false;
         status = SYSTEM_MODE;      // Yield is a kernel routine.
-        currentThread->Yield();
+        currentThread->Preempt();
         status = old;
     }
 }
@@ -200,8 +356,24 @@ Interrupt::Idle(bool consoleRunning)
     status = IDLE_MODE;
 
     DEBUG('i', "The console is: %i.\n", consoleRunning);
-    if (! consoleRunning && CheckIfDue(true)) {           // Check for any pending interrupts and check if the console is unnecessary waiting
+    bool due = false;
+    // Check for any pending interrupts, unless the console is unnecessarily
+    // waiting.
+    if (! consoleRunning) {
+        if (numArmed > 0) {
+            CheckInput(0);
+        }
+        due = CheckIfDue(true);
 
+        // Nothing happens until some device gets input, so the host process
+        // can sleep meanwhile.
+        while (!due && numArmed > 0) {
+            DEBUG('i', "Waiting for input on the host.\n");
+            CheckInput(-1);
+            due = CheckIfDue(true);
+        }
+    }
+    if (due) {
         while (CheckIfDue(false)) {}  // Check for any other pending
                                       // interrupts.
         yieldOnReturn = false;        // Since there is nothing in the ready
@@ -211,9 +383,10 @@ Interrupt::Idle(bool consoleRunning)
     }
 
     // If there are no pending interrupts, and nothing is on the ready queue,
-    // it is time to stop.  If the console or the network is operating, there
-    // are *always* pending interrupts, so this code is not reached.
-    // Instead, the halt must be invoked by the user program.
+    // it is time to stop.  If the console or the network is operating, they
+    // always either have an interrupt pending or wait for input, so this
+    // code is not reached.  Instead, the halt must be invoked by the user
+    // program.
 
     DEBUG('i', "Machine idle.  No interrupts to do.\n");
     printf("No threads ready or runnable, and no pending interrupts.\n");
@@ -227,6 +400,7 @@ Interrupt::Halt()
 {
     printf("Machine halting!\n\n");
     stats->Print();
+    Lock::PrintContention();
     Cleanup();  // Never returns.
 }
 
@@ -240,19 +414,13 @@ Interrupt::Halt()
 void
 Interrupt::RestartTicks()
 {
-    List<PendingInterrupt *> *oldPending = pending;
-    pending = new List<PendingInterrupt *>;
-
-    PendingInterrupt *i;
-    unsigned          oldWhen = 0;
-    while ((i = oldPending->SortedPop((int *) &oldWhen)) != nullptr) {
-        unsigned newWhen = oldWhen - stats->totalTicks;
-        pending->SortedInsert(i, newWhen);
-        DEBUG('x', "Interrupt at time %u re-scheduled at new time %u.\n",
-              oldWhen, newWhen);
-    }
+    DEBUG('x', "Re-scheduling %u pending interrupts %lu ticks earlier.\n",
+          pending.Size(), stats->totalTicks);
+    pending.Rebase(stats->totalTicks);
+    nextInputCheck = nextInputCheck > stats->totalTicks
+                     ? nextInputCheck - stats->totalTicks : 0;
+    UpdateNextDue();
 
-    delete oldPending;
     stats->totalTicks = 0;
     stats->tickResets += 1;
 }
@@ -261,7 +429,7 @@ Interrupt::RestartTicks()
 /// Arrange for the CPU to be interrupted when simulated time reaches `now +
 /// when`.
 ///
-/// Implementation: just put it on a sorted list.
+/// Implementation: just put it on the pending heap.
 ///
 /// NOTE: the Nachos kernel should not call this routine directly.  Instead,
 /// it is only called by the hardware device simulators.
@@ -290,14 +458,99 @@ Interrupt::Schedule(VoidFunctionPtr handler, void *arg,
     ASSERT(ULONG_MAX - stats->totalTicks > fromNow);
 #endif
 
-    unsigned when = stats->totalTicks + fromNow;
+    unsigned long when = stats->totalTicks + fromNow;
     PendingInterrupt *toOccur = new PendingInterrupt(handler, arg,
                                                      when, type);
 
-    DEBUG('i', "Scheduling interrupt handler the %s at time = %u\n",
+    DEBUG('i', "Scheduling interrupt handler the %s at time = %lu\n",
           INT_TYPE_NAMES[type], when);
 
-    pending->SortedInsert(toOccur, when);
+    pending.Insert(toOccur);
+    if (when < nextDue) {
+        nextDue = when;
+    }
+}
+
+/// Implementation: the watch is kept in `watches`, and the host
+/// multiplexer reports it with a pointer to its entry.  A file the host
+/// cannot watch (a regular one) always has something to read, so its
+/// handler is simply scheduled after `INPUT_CHECK_TIME`.
+///
+/// * `fd` is the host file.
+/// * `handler`, `arg`, `type` -- as in `Schedule`.
+void
+Interrupt::WatchInput(int fd, VoidFunctionPtr handler, void *arg,
+                      IntType type)
+{
+    ASSERT(fd >= 0);
+    ASSERT(handler != nullptr);
+    ASSERT(IsIntType(type));
+
+    InputWatch *watch = nullptr;
+    for (unsigned i = 0; i < MAX_INPUT_WATCHES; i++) {
+        if (watches[i].fd == fd) {
+            watch = &watches[i];
+            break;
+        } else if (watch == nullptr && watches[i].fd == -1) {
+            watch = &watches[i];
+        }
+    }
+    ASSERT(watch != nullptr);
+
+    if (!SystemDep::WatchInput(fd, watch)) {
+        Schedule(handler, arg, INPUT_CHECK_TIME, type);
+        return;
+    }
+    DEBUG('i', "Watching host file %d for the %s\n", fd, INT_TYPE_NAMES[type]);
+    watch->fd      = fd;
+    watch->handler = handler;
+    watch->arg     = arg;
+    watch->type    = type;
+    if (!watch->armed) {
+        watch->armed = true;
+        if (numArmed++ == 0) {
+            nextInputCheck = stats->totalTicks + INPUT_CHECK_TIME;
+        }
+        UpdateNextDue();
+    }
+}
+
+void
+Interrupt::UnwatchInput(int fd)
+{
+    for (unsigned i = 0; i < MAX_INPUT_WATCHES; i++) {
+        if (watches[i].fd == fd) {
+            SystemDep::UnwatchInput(fd);
+            if (watches[i].armed) {
+                numArmed--;
+            }
+            watches[i].fd    = -1;
+            watches[i].armed = false;
+            UpdateNextDue();
+            return;
+        }
+    }
+}
+
+/// The handlers run at the next tick, like any other interrupt.
+void
+Interrupt::CheckInput(int milliseconds)
+{
+    void *ready[MAX_INPUT_WATCHES];
+    unsigned count = SystemDep::WaitForInput(milliseconds, ready,
+                                             MAX_INPUT_WATCHES);
+    for (unsigned i = 0; i < count; i++) {
+        InputWatch *watch = (InputWatch *) ready[i];
+        if (!watch->armed) {
+            continue;
+        }
+        DEBUG('i', "Input on host file %d\n", watch->fd);
+        watch->armed = false;
+        numArmed--;
+        Schedule(watch->handler, watch->arg, 1, watch->type);
+    }
+    nextInputCheck = stats->totalTicks + INPUT_CHECK_TIME;
+    UpdateNextDue();
 }
 
 /// Check if an interrupt is scheduled to occur, and if so, fire it off.
@@ -312,42 +565,47 @@ bool
 Interrupt::CheckIfDue(bool advanceClock)
 {
     MachineStatus old = status;
-    unsigned      when;
 
     ASSERT(level == INT_OFF);  // Interrupts need to be disabled, to invoke
                                // an interrupt handler.
-    if (debug.IsEnabled('i')) {
+    if (DEBUG_ENABLED('i')) {
         DumpState();
     }
-    PendingInterrupt *toOccur = pending->SortedPop((int *) &when);
+    PendingInterrupt *toOccur = pending.Head();
 
     if (toOccur == nullptr) {  // No pending interrupts.
         return false;
     }
 
+    unsigned long when = toOccur->when;
     if (advanceClock && when > stats->totalTicks) {  // Advance the clock.
         stats->idleTicks += (when - stats->totalTicks);
         stats->totalTicks = when;
-    } else if (when > stats->totalTicks) {  // Not time yet, put it back.
-        pending->SortedInsert(toOccur, when);
+    } else if (when > stats->totalTicks) {  // Not time yet, leave it there.
         return false;
     }
 
     // Check if there is nothing more to do, and if so, quit.
     if (status == IDLE_MODE && toOccur->type == TIMER_INT
-          && pending->IsEmpty()) {
-        pending->SortedInsert(toOccur, when);
+          && pending.Size() == 1) {
         return false;
     }
 
-    DEBUG('i', "Invoking interrupt handler for the %s at time %u\n",
+    pending.Pop();
+    UpdateNextDue();
+
+    DEBUG('i', "Invoking interrupt handler for the %s at time %lu\n",
             INT_TYPE_NAMES[toOccur->type], toOccur->when);
 #ifdef USER_PROGRAM
-    if (machine != nullptr) {
+    // Only if the machine holds the registers of the running thread; see
+    // `Scheduler::SwitchUserContext`.
+    if (machine != nullptr && currentThread != nullptr
+          && currentThread->space != nullptr) {
         machine->DelayedLoad(0, 0);
     }
 #endif
     inHandler = true;
+    interruptedStatus = old;
     status = SYSTEM_MODE;  // Whatever we were doing, we are now going to be
                            // running in the kernel.
     (*toOccur->handler)(toOccur->arg);  // Call the interrupt handler.
@@ -394,10 +652,10 @@ Interrupt::DumpState()
     printf("Time: %lu, interrupts %s\n",
            stats->totalTicks, INT_LEVEL_NAMES[level]);
 
-    if (pending->IsEmpty()) {
+    if (pending.IsEmpty()) {
         printf("No pending interrupts\n");
     } else {
         printf("Pending interrupts:\n");
-        pending->Apply(PrintPending);
+        pending.Apply(PrintPending);
     }
 }
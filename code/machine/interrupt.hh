@@ -36,7 +36,7 @@
 #define NACHOS_MACHINE_INTERRUPT__HH
 
 
-#include "lib/list.hh"
+#include "lib/utility.hh"
 
 
 /// Interrupts can be disabled (`INT_OFF`) or enabled (`INT_ON`).
@@ -58,7 +58,9 @@ enum MachineStatus {
 
 /// `IntType` records which hardware device generated an interrupt.  In
 /// Nachos, we support a hardware timer device, a disk, a console display and
-/// keyboard, and a network.
+/// keyboard, and a network; plus the retransmission timeouts of the
+/// reliable network transport (see `network/transport.hh`) and those of
+/// threads waiting on a semaphore for a limited time.
 enum IntType {
     TIMER_INT,
     DISK_INT,
@@ -66,9 +68,14 @@ enum IntType {
     CONSOLE_READ_INT,
     NETWORK_SEND_INT,
     NETWORK_RECV_INT,
+    TRANSPORT_INT,
+    WAIT_INT,
     NUM_INT_TYPES
 };
 
+/// Host files watched for devices at the same time, at most.
+const unsigned MAX_INPUT_WATCHES = 8;
+
 /// The following class defines an interrupt that is scheduled to occur in
 /// the future.
 ///
@@ -86,9 +93,57 @@ public:
                               ///< occurs.
     void *arg;  ///< The argument to the function.
     unsigned long when;  ///< When the interrupt is supposed to fire.
+    unsigned long order;  ///< Breaks ties between interrupts due at the
+                          ///< same time: the first scheduled fires first.
     IntType type;  ///< For debugging.
 };
 
+/// Pending interrupts, kept in a binary min-heap ordered by `when` (and by
+/// `order` for equal times).
+///
+/// Inserting and removing take logarithmic time and never allocate once
+/// the array has grown to the largest number of interrupts ever pending;
+/// peeking at the next interrupt takes constant time.
+class PendingQueue {
+public:
+
+    PendingQueue();
+
+    ~PendingQueue();
+
+    /// Add `pend`, stamping it with its arrival order.
+    void Insert(PendingInterrupt *pend);
+
+    /// Return the interrupt due first, without removing it; null if empty.
+    PendingInterrupt *Head() const;
+
+    /// Remove and return the interrupt due first; null if empty.
+    PendingInterrupt *Pop();
+
+    bool IsEmpty() const;
+
+    unsigned Size() const;
+
+    /// Subtract `ticks` from the due time of every pending interrupt.
+    void Rebase(unsigned long ticks);
+
+    /// Apply `func` to every pending interrupt, in no particular order.
+    void Apply(void (*func)(PendingInterrupt *)) const;
+
+private:
+
+    /// Does `a` fire before `b`?
+    static bool Before(const PendingInterrupt *a, const PendingInterrupt *b);
+
+    void SiftUp(unsigned i);
+    void SiftDown(unsigned i);
+
+    PendingInterrupt **heap;
+    unsigned size;
+    unsigned capacity;
+    unsigned long nextOrder;  ///< Stamp for the next inserted interrupt.
+};
+
 /// The following class defines the data structures for the simulation
 /// of hardware interrupts.
 ///
@@ -125,6 +180,13 @@ public:
     // Idle, kernel, user.
     MachineStatus GetStatus() const;
 
+    /// What the machine was doing when the interrupt being handled came;
+    /// lets a handler tell whether it stopped a user program.
+    MachineStatus GetInterruptedStatus() const
+    {
+        return interruptedStatus;
+    }
+
     void SetStatus(MachineStatus st);
 
     // Print interrupt state.
@@ -142,23 +204,74 @@ public:
     void Schedule(VoidFunctionPtr handler, void *arg,
                   unsigned long when, IntType type);
 
+    /// Call `handler` with `arg`, as an interrupt of type `type`, once the
+    /// host file `fd` has something to read.  The watch goes off once.
+    ///
+    /// This is for devices that would otherwise poll the file forever:
+    /// while a watch is waiting, the file is looked at every
+    /// `INPUT_CHECK_TIME` ticks, and when the machine has nothing else to
+    /// do the host process sleeps until some input comes.
+    void WatchInput(int fd, VoidFunctionPtr handler, void *arg,
+                    IntType type);
+
+    /// Stop watching `fd`, before closing it.
+    void UnwatchInput(int fd);
+
     /// Advance simulated time.
     void OneTick();
 
+    /// Time at which `OneTick` next has something to do, `ULONG_MAX` if no
+    /// interrupt is pending.
+    unsigned long NextDue() const
+    {
+        return nextDue;
+    }
+
+    /// Has a context switch been requested for the next tick?
+    bool YieldPending() const
+    {
+        return yieldOnReturn;
+    }
+
 private:
     IntStatus level;  ///< Are interrupts enabled or disabled?
-    List<PendingInterrupt *> *pending;  ///< The list of interrupts scheduled
-                                        ///< to occur in the future.
+    PendingQueue pending;  ///< The interrupts scheduled to occur in the
+                           ///< future.
+    unsigned long nextDue;  ///< When the first pending interrupt is due,
+                            ///< `ULONG_MAX` if there is none.  Lets
+                            ///< `OneTick` skip the queue on most ticks.
     bool inHandler;  ///< True if we are running an interrupt handler.
     bool yieldOnReturn;  ///< True if we are to context switch on return from
                          ///< the interrupt handler.
     MachineStatus status;  ///< Idle, kernel mode, user mode.
+    MachineStatus interruptedStatus;  ///< `status` when the current
+                                      ///< handler was called.
+
+    /// A host file watched for a device.
+    struct InputWatch {
+        int fd;                   ///< -1 if the entry is free.
+        bool armed;               ///< Has not gone off yet.
+        VoidFunctionPtr handler;
+        void *arg;
+        IntType type;
+    };
+    InputWatch watches[MAX_INPUT_WATCHES];
+    unsigned numArmed;
+    unsigned long nextInputCheck;  ///< When `OneTick` next looks at the
+                                   ///< watched files, if any is armed.
 
     /// These functions are internal to the interrupt simulation code.
 
     /// Check if an interrupt is supposed to occur now.
     bool CheckIfDue(bool advanceClock);
 
+    /// Refresh `nextDue` after the pending queue changed.
+    void UpdateNextDue();
+
+    /// Schedule the handlers of the watches whose files have something to
+    /// read, waiting up to `milliseconds` (forever if negative) for one.
+    void CheckInput(int milliseconds);
+
     /// SetLevel, without advancing the simulated time.
     void ChangeLevel(IntStatus old,
                      IntStatus now);
@@ -107,6 +107,9 @@ public:
     /// Run a certain instruction of a user program.
     void ExecInstruction(const Instruction *instr);
 
+    /// Run instructions for as long as no interrupt can become due.
+    void RunUntilDue(Instruction *instr);
+
     /// Do a pending delayed load (modifying a reg).
     void DelayedLoad(unsigned nextReg, int nextVal);
 
@@ -30,12 +30,15 @@ Machine::Run()
     Instruction *instr = new Instruction;
       // Storage for decoded instruction.
 
-    if (debug.IsEnabled('m')) {
+    if (DEBUG_ENABLED('m')) {
         printf("Starting to run at time %lu\n", stats->totalTicks);
     }
     interrupt->SetStatus(USER_MODE);
 
     for (;;) {
+        if (singleStepper == nullptr && !DEBUG_ENABLED('i')) {
+            RunUntilDue(instr);
+        }
         if (FetchInstruction(instr)) {
             ExecInstruction(instr);
         }
@@ -46,6 +49,29 @@ Machine::Run()
     }
 }
 
+/// Execute user instructions while the tick that follows each one cannot
+/// make an interrupt due, nor has a yield been requested.
+///
+/// Their time is accounted here, and `Interrupt::OneTick` is left for the
+/// instruction that reaches the deadline, so interrupts fire at exactly the
+/// same tick as when every instruction goes through `OneTick` (which keeps
+/// `-rs` runs reproducible).  Kernel code run on an exception may schedule
+/// new interrupts, so the deadline is read again after every instruction.
+void
+Machine::RunUntilDue(Instruction *instr)
+{
+    ASSERT(instr != nullptr);
+
+    while (stats->totalTicks + USER_TICK < interrupt->NextDue()
+             && !interrupt->YieldPending()) {
+        if (FetchInstruction(instr)) {
+            ExecInstruction(instr);
+        }
+        stats->totalTicks += USER_TICK;
+        stats->userTicks  += USER_TICK;
+    }
+}
+
 /// Simulate effects of a delayed load.
 ///
 /// NOTE -- `RaiseException`/`CheckInterrupts` must also call `DelayedLoad`,
@@ -71,7 +97,7 @@ Machine::FetchInstruction(Instruction *instr)
     instr->value = raw;
     instr->Decode();
 
-    if (debug.IsEnabled('m')) {
+    if (DEBUG_ENABLED('m')) {
         const struct OpString *str = &OP_STRINGS[instr->opCode];
 
         ASSERT(instr->opCode <= MAX_OPCODE);
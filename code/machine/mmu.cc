@@ -179,6 +179,19 @@ MMU::RetrievePageEntry(unsigned vpn, TranslationEntry **entry) const
     if (tlb == nullptr) {
         // Use a page table; `vpn` is an index in the table.
 
+#ifdef MULTILEVEL_PAGE_TABLE
+        TranslationEntry *e = pageTable->Lookup(vpn);
+        if (e == nullptr) {
+            DEBUG_CONT('a', "virtual page # %u not mapped!\n", vpn);
+            return ADDRESS_ERROR_EXCEPTION;
+        } else if (!e->valid) {
+            DEBUG_CONT('a', "virtual page # %u not valid!\n", vpn);
+            return PAGE_FAULT_EXCEPTION;
+        }
+
+        *entry = e;
+        return NO_EXCEPTION;
+#else
         if (vpn >= pageTableSize) {
             DEBUG_CONT('a', "virtual page # %u too large for"
                             " page table size %u!\n",
@@ -193,6 +206,7 @@ MMU::RetrievePageEntry(unsigned vpn, TranslationEntry **entry) const
 
         *entry = &pageTable[vpn];
         return NO_EXCEPTION;
+#endif
 
     } else {
         // Use the TLB.
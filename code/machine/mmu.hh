@@ -13,6 +13,10 @@
 #include "disk.hh"
 #include "translation_entry.hh"
 
+#ifdef MULTILEVEL_PAGE_TABLE
+#include "page_table.hh"
+#endif
+
 
 /// Definitions related to the size, and format of user memory.
 
@@ -72,7 +76,8 @@ public:
     /// * a software-loaded translation lookaside buffer (tlb) -- a cache of
     ///   mappings of virtual page #'s to physical page #'s.
     ///
-    /// If `tlb` is null, the linear page table is used.
+    /// If `tlb` is null, the linear page table is used (a two-level one
+    /// when built with `MULTILEVEL_PAGE_TABLE`).
     /// If `tlb` is non-null, the Nachos kernel is responsible for managing
     /// the contents of the TLB.  But the kernel can use any data structure
     /// it wants (eg, segmented paging) for handling TLB cache misses.
@@ -87,7 +92,11 @@ public:
     TranslationEntry *tlb;  ///< This pointer should be considered
                             ///< “read-only” to Nachos kernel code.
 
+#ifdef MULTILEVEL_PAGE_TABLE
+    PageTable *pageTable;
+#else
     TranslationEntry *pageTable;
+#endif
     unsigned pageTableSize;
 
 private:
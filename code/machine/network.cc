@@ -54,21 +54,27 @@ Network::Network(NetworkAddress addr, double reliability,
     writeHandler = writeDone;
     readHandler = readAvail;
     handlerArg = callArg;
-    sendBusy = false;
+    sendsPending = 0;
+    wireFreeAt = 0;
+    outCount = 0;
+    inFirst = 0;
+    inCount = 0;
     inHdr.length = 0;
+    inbox = nullptr;
 
     sock = SystemDep::OpenSocket();
     snprintf(sockName, sizeof sockName, "SOCKET_%u", (unsigned) addr);
     SystemDep::AssignNameToSocket(sockName, sock);
       // Bind socket to a filename in the current directory.
 
-    // Start polling for incoming packets.
-    interrupt->Schedule(NetworkReadPoll, this,
-                        NETWORK_TIME, NETWORK_RECV_INT);
+    // Wait for incoming packets.
+    interrupt->WatchInput(sock, NetworkReadPoll, this, NETWORK_RECV_INT);
 }
 
 Network::~Network()
 {
+    Flush();  // Whatever was sent right before halting.
+    interrupt->UnwatchInput(sock);
     SystemDep::CloseSocket(sock);
     SystemDep::DeAssignNameToSocket(sockName);
 }
@@ -76,67 +82,115 @@ Network::~Network()
 /// If a packet is already buffered, we simply delay reading the incoming
 /// packet.  In real life, the incoming packet might be dropped if we cannot
 /// read it in time.
+///
+/// Packets are read from the host as many at a time as there are, and are
+/// delivered one after the other for as long as the handler takes them.
+/// Once there are no more, polling stops until the interrupt simulation
+/// sees the socket has something to read.
 void
 Network::CheckPktAvail()
 {
-    // Schedule the next time to poll for a packet.
-    interrupt->Schedule(NetworkReadPoll, this,
-                        NETWORK_TIME, NETWORK_RECV_INT);
-
-    if (inHdr.length != 0) {  // Do nothing if packet is already buffered.
-        return;
+    // First, what was sent and not handed to the host yet, so that a
+    // machine sending to itself gets it now.
+    Flush();
+
+    while (inHdr.length == 0) {  // Do nothing if packet is already buffered.
+        if (inCount == 0) {
+            inFirst = 0;
+            inCount = SystemDep::ReadFromSocketBatch(sock, inQueue[0],
+                                                     MAX_WIRE_SIZE,
+                                                     NETWORK_QUEUE_SIZE);
+            if (inCount == 0) {  // Wait for the next packet.
+                interrupt->WatchInput(sock, NetworkReadPoll, this,
+                                      NETWORK_RECV_INT);
+                return;
+            }
+            stats->numPacketBatchesRecvd++;
+        }
+
+        // Divide packet into header and data.
+        const char *packet = inQueue[inFirst++];
+        inCount--;
+        inHdr = *(const PacketHeader *) packet;
+        ASSERT(inHdr.to == ident && inHdr.length <= MAX_PACKET_SIZE);
+        inbox = packet + sizeof (PacketHeader);
+
+        DEBUG('n', "Network received packet from %d, length %u...\n",
+              (int) inHdr.from, inHdr.length);
+        stats->numPacketsRecvd++;
+
+        // Tell post office that the packet has arrived.
+        (*readHandler)(handlerArg);
     }
-    if (!SystemDep::PollSocket(sock)) {  // Do nothing if no packet to read.
-        return;
-    }
-
-    // Otherwise, read packet in.
-    char *buffer = new char [MAX_WIRE_SIZE];
-    SystemDep::ReadFromSocket(sock, buffer, MAX_WIRE_SIZE);
-
-    // Divide packet into header and data.
-    inHdr = *(PacketHeader *) buffer;
-    ASSERT(inHdr.to == ident && inHdr.length <= MAX_PACKET_SIZE);
-    memcpy(inbox, buffer + sizeof (PacketHeader), inHdr.length);
-    delete [] buffer;
-
-    DEBUG('n', "Network received packet from %d, length %u...\n",
-          (int) inHdr.from, inHdr.length);
-    stats->numPacketsRecvd++;
 
-    // Tell post office that the packet has arrived.
-    (*readHandler)(handlerArg);
+    // Schedule the next time to poll, to see if the packet was taken.
+    interrupt->Schedule(NetworkReadPoll, this,
+                        NETWORK_TIME, NETWORK_RECV_INT);
 }
 
 /// Notify user that another packet can be sent.
+///
+/// The packets waiting in `outQueue` are off the wire by now, so they go
+/// to the host.
 void
 Network::SendDone()
 {
-    sendBusy = false;
+    ASSERT(sendsPending > 0);
+    Flush();
+    sendsPending--;
     stats->numPacketsSent++;
     (*writeHandler)(handlerArg);
 }
 
+void
+Network::Flush()
+{
+    if (outCount == 0) {
+        return;
+    }
+    const char *names[NETWORK_QUEUE_SIZE];
+    for (unsigned i = 0; i < outCount; i++) {
+        names[i] = outNames[i];
+    }
+    unsigned delivered = SystemDep::SendToSocketBatch(sock, outQueue[0],
+                                                      MAX_WIRE_SIZE,
+                                                      names, outCount);
+    if (delivered < outCount) {
+        // Like a real network, lose what goes to a machine that is down.
+        DEBUG('n', "Nobody at the address of %u packets, lost them!\n",
+              outCount - delivered);
+    }
+    stats->numPacketBatchesSent++;
+    outCount = 0;
+}
+
 /// Send a packet by concatenating hdr and data, and schedule an interrupt to
 /// tell the user when the next packet can be sent.
 ///
 /// Note we always pad out a packet to `MAX_WIRE_SIZE` before putting it into
 /// the socket, because it is simpler at the receive end.
+///
+/// The packet waits in `outQueue` until the first send pending is done (or
+/// until the queue fills), so that packets sent close together reach the
+/// host in a single batch.
 void
 Network::Send(PacketHeader hdr, const char *data)
 {
     ASSERT(data != nullptr);
-
-    char toName[32];
-
-    snprintf(toName, sizeof toName, "SOCKET_%u", (unsigned) hdr.to);
-
-    ASSERT(!sendBusy && hdr.length > 0
+    ASSERT(sendsPending < NETWORK_QUEUE_SIZE && hdr.length > 0
            && hdr.length <= MAX_PACKET_SIZE && hdr.from == ident);
     DEBUG('n', "Sending to addr %u, %u bytes... ", hdr.to, hdr.length);
 
+    // The packet goes out on the wire once the ones before it are done.
+    unsigned long now   = stats->totalTicks;
+    unsigned long start = now;
+    if (sendsPending > 0 && wireFreeAt > now) {
+        start = wireFreeAt;
+    }
+    wireFreeAt = start + NETWORK_TIME;
+    sendsPending++;
     interrupt->Schedule(NetworkSendDone, this,
-                        NETWORK_TIME, NETWORK_SEND_INT);
+                        wireFreeAt - now, NETWORK_SEND_INT);
 
     // Emulate a lost packet.
     if (SystemDep::Random() % 100 >= chanceToWork * 100) {
@@ -144,12 +198,16 @@ Network::Send(PacketHeader hdr, const char *data)
         return;
     }
 
-    // Concatenate `hdr` and `data` into a single buffer, and send it out.
-    char *buffer = new char [MAX_WIRE_SIZE];
-    *(PacketHeader *) buffer = hdr;
-    memcpy(buffer + sizeof (PacketHeader), data, hdr.length);
-    SystemDep::SendToSocket(sock, buffer, MAX_WIRE_SIZE, toName);
-    delete [] buffer;
+    // Concatenate `hdr` and `data` into a single buffer, and queue it.
+    if (outCount == NETWORK_QUEUE_SIZE) {
+        Flush();
+    }
+    char *packet = outQueue[outCount];
+    *(PacketHeader *) packet = hdr;
+    memcpy(packet + sizeof (PacketHeader), data, hdr.length);
+    snprintf(outNames[outCount], sizeof outNames[outCount],
+             "SOCKET_%u", (unsigned) hdr.to);
+    outCount++;
 }
 
 // Read a packet, if one is buffered.
@@ -47,6 +47,10 @@ const unsigned MAX_WIRE_SIZE = 64;
 /// Data “payload” of the largest packet.
 const unsigned MAX_PACKET_SIZE = MAX_WIRE_SIZE - sizeof (PacketHeader);
 
+/// Packets the device holds on each side: sent and waiting to go out on
+/// the wire, and arrived but not taken yet.
+const unsigned NETWORK_QUEUE_SIZE = 16;
+
 
 /// The following class defines a physical network device.
 ///
@@ -71,10 +75,13 @@ public:
 
     /// Send the packet data to a remote machine, specified by `hdr`.
     ///
-    /// Returns immediately.
+    /// Returns immediately.  Up to `NETWORK_QUEUE_SIZE` packets can be
+    /// waiting to be sent; they take `NETWORK_TIME` each, one after the
+    /// other.
     ///
-    /// `writeHandler` is invoked once the next packet can be sent.  Note
-    /// that `writeHandler` is called whether or not the packet is dropped.
+    /// `writeHandler` is invoked once for each packet, when it is done and
+    /// one more can be sent.  Note that `writeHandler` is called whether or
+    /// not the packet is dropped.
     ///
     /// Also note that the `from` field of the `PacketHeader` is filled in
     /// automatically by `Send`.
@@ -92,6 +99,9 @@ public:
     /// Check if there is an incoming packet.
     void CheckPktAvail();
 
+    /// Hand the packets sent so far to the host, all at once.
+    void Flush();
+
 private:
 
     /// This machine's network address.
@@ -115,17 +125,29 @@ private:
     /// Argument to be passed to interrupt handler (pointer to post office).
     void *handlerArg;
 
-    /// Packet is being sent.
-    bool sendBusy;
+    /// Packets sent and not done yet.
+    unsigned sendsPending;
+
+    /// When the last packet sent will be done.
+    unsigned long wireFreeAt;
+
+    /// Packets sent and not handed to the host yet, with the names of the
+    /// sockets they go to.
+    char outQueue[NETWORK_QUEUE_SIZE][MAX_WIRE_SIZE];
+    char outNames[NETWORK_QUEUE_SIZE][32];
+    unsigned outCount;
 
-    /// Packet has arrived, can be pulled off of network.
-    bool packetAvail;
+    /// Packets read from the host and not delivered yet: `inCount` of
+    /// them, from `inQueue[inFirst]` on.
+    char inQueue[NETWORK_QUEUE_SIZE][MAX_WIRE_SIZE];
+    unsigned inFirst;
+    unsigned inCount;
 
     /// Information about arrived packet.
     PacketHeader inHdr;
 
-    /// Data for arrived packet.
-    char inbox[MAX_PACKET_SIZE];
+    /// Data for arrived packet, inside `inQueue`.
+    const char *inbox;
 };
 
 
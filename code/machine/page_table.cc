@@ -0,0 +1,68 @@
+/// Copyright (c) 2019-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "page_table.hh"
+
+
+PageTable::PageTable()
+{
+    directory = nullptr;
+    directorySize = 0;
+}
+
+PageTable::~PageTable()
+{
+    for (unsigned i = 0; i < directorySize; i++) {
+        delete [] directory[i];
+    }
+    delete [] directory;
+}
+
+TranslationEntry *
+PageTable::Map(unsigned vpn)
+{
+    ASSERT(vpn != UNMAPPED);
+
+    unsigned dir = vpn / PAGE_TABLE_CHUNK_SIZE;
+    if (dir >= directorySize) {
+        // Grow the directory so that it reaches `dir`.
+        TranslationEntry **newDirectory = new TranslationEntry * [dir + 1];
+        for (unsigned i = 0; i <= dir; i++) {
+            newDirectory[i] = i < directorySize ? directory[i] : nullptr;
+        }
+        delete [] directory;
+        directory = newDirectory;
+        directorySize = dir + 1;
+    }
+
+    if (directory[dir] == nullptr) {
+        directory[dir] = new TranslationEntry [PAGE_TABLE_CHUNK_SIZE];
+        for (unsigned i = 0; i < PAGE_TABLE_CHUNK_SIZE; i++) {
+            directory[dir][i].virtualPage = UNMAPPED;
+            directory[dir][i].valid = false;
+        }
+    }
+
+    TranslationEntry *entry = &directory[dir][vpn % PAGE_TABLE_CHUNK_SIZE];
+    entry->virtualPage  = vpn;
+    entry->physicalPage = 0;
+    entry->valid        = false;
+    entry->readOnly     = false;
+    entry->use          = false;
+    entry->dirty        = false;
+    return entry;
+}
+
+unsigned
+PageTable::GetNumChunks() const
+{
+    unsigned count = 0;
+    for (unsigned i = 0; i < directorySize; i++) {
+        if (directory[i] != nullptr) {
+            count++;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,72 @@
+/// A two-level page table, for address spaces with large holes.
+///
+/// Copyright (c) 2019-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_MACHINE_PAGETABLE__HH
+#define NACHOS_MACHINE_PAGETABLE__HH
+
+
+#include "translation_entry.hh"
+
+
+/// Number of entries in each second-level table.
+const unsigned PAGE_TABLE_CHUNK_SIZE = 64;
+
+
+/// The virtual page number is split in two: the high bits select an entry
+/// of the page directory and the low bits select an entry inside the
+/// second-level table it points to.  Second-level tables are allocated only
+/// for the regions of the address space that get mapped, so an address space
+/// with a hole in the middle (for instance, between the program and a stack
+/// placed at the top) pays only for the pages around what it actually uses.
+///
+/// The MMU walks this structure when there is no TLB; otherwise only the
+/// kernel uses it, to refill the TLB.
+class PageTable {
+public:
+
+    /// Initialize an empty page table: nothing is mapped.
+    PageTable();
+
+    /// De-allocate the directory and every second-level table.
+    ~PageTable();
+
+    /// Make `vpn` part of the address space, allocating its second-level
+    /// table if needed.  The new entry is invalid and not read-only.
+    TranslationEntry *Map(unsigned vpn);
+
+    /// Return the entry for `vpn`, or null if the page is not mapped.
+    TranslationEntry *Lookup(unsigned vpn) const
+    {
+        unsigned dir = vpn / PAGE_TABLE_CHUNK_SIZE;
+        if (dir >= directorySize || directory[dir] == nullptr) {
+            return nullptr;
+        }
+        TranslationEntry *entry = &directory[dir][vpn % PAGE_TABLE_CHUNK_SIZE];
+        return entry->virtualPage == vpn ? entry : nullptr;
+    }
+
+    /// Entry of a page that must be mapped.
+    TranslationEntry &operator[](unsigned vpn) const
+    {
+        TranslationEntry *entry = Lookup(vpn);
+        ASSERT(entry != nullptr);
+        return *entry;
+    }
+
+    /// Number of second-level tables allocated so far.
+    unsigned GetNumChunks() const;
+
+private:
+
+    /// Unmapped entries hold this value as their virtual page number.
+    static const unsigned UNMAPPED = (unsigned) -1;
+
+    TranslationEntry **directory;
+    unsigned directorySize;
+};
+
+
+#endif
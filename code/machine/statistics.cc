@@ -21,10 +21,19 @@ Statistics::Statistics()
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numRetransmissions = 0;
+    numSharedFaults = numSharedPagesRecvd = numSharedInvalidations = 0;
+    numPacketBatchesSent = numPacketBatchesRecvd = 0;
     numPagetoTLB = numPageToSwap = numPageHit = 0;
+    numPagesPrefetched = 0;
+    numZeroPagesMapped = numZeroPagesCopied = 0;
+    numStacksAllocated = numStacksReused = 0;
+    numLockContentions = 0;
 #ifdef DFS_TICKS_FIX
     tickResets = 0;
 #endif
+    printSpeed = false;
+    hostStartTime = SystemDep::HostTime();
 
 }
 
@@ -41,11 +50,23 @@ Statistics::Print()
 #endif
     printf("Ticks: total %lu, idle %lu, system %lu, user %lu\n",
            totalTicks, idleTicks, systemTicks, userTicks);
+    if (numStacksAllocated != 0) {
+        printf("Stacks: allocated %lu, reused %lu\n",
+               numStacksAllocated, numStacksReused);
+    }
+    if (numLockContentions != 0) {
+        printf("Locks: contentions %lu\n", numLockContentions);
+    }
     printf("Disk I/O: reads %lu, writes %lu\n", numDiskReads, numDiskWrites);
     printf("Console I/O: reads %lu, writes %lu\n",
            numConsoleCharsRead, numConsoleCharsWritten);
     printf("Paging: faults %lu\n", numPageFaults);
     printf("Paging: hits %lu\n", numPageHit);
+#ifdef DEMAND_LOADING
+    printf("Paging: prefetched %lu\n", numPagesPrefetched);
+    printf("Paging: zero pages mapped %lu, copied on write %lu\n",
+           numZeroPagesMapped, numZeroPagesCopied);
+#endif
 
     double miss = numPageFaults;
     double hit = numPageHit;
@@ -56,4 +77,19 @@ Statistics::Print()
 
     printf("Network I/O: packets received %lu, sent %lu\n",
            numPacketsRecvd, numPacketsSent);
+#ifdef NETWORK
+    printf("Network I/O: host batches received %lu, sent %lu\n",
+           numPacketBatchesRecvd, numPacketBatchesSent);
+    printf("Network transport: fragments retransmitted %lu\n",
+           numRetransmissions);
+    printf("Shared memory: faults %lu, pages received %lu, invalidated %lu\n",
+           numSharedFaults, numSharedPagesRecvd, numSharedInvalidations);
+#endif
+
+    if (printSpeed) {
+        double elapsed = SystemDep::HostTime() - hostStartTime;
+        printf("Speed: %.3f s, %.2f M ticks/s, %.2f M user instructions/s\n",
+               elapsed, totalTicks / elapsed / 1e6,
+               userTicks / USER_TICK / elapsed / 1e6);
+    }
 }
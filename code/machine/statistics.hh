@@ -53,6 +53,20 @@ public:
     /// Number of packets received over the network.
     unsigned long numPacketsRecvd;
 
+    /// Number of fragments the reliable transport had to send again.
+    unsigned long numRetransmissions;
+
+    /// Number of pages of the distributed shared memory asked for, of those
+    /// that came with their data, and of copies invalidated.
+    unsigned long numSharedFaults;
+    unsigned long numSharedPagesRecvd;
+    unsigned long numSharedInvalidations;
+
+    /// Number of times the network handed packets to the host, or got
+    /// them from it (each time, as many as it could).
+    unsigned long numPacketBatchesSent;
+    unsigned long numPacketBatchesRecvd;
+
     ///***
     /// Number of virtual memory page hits
     unsigned long numPageHit;
@@ -60,6 +74,18 @@ public:
     unsigned long numPageToSwap;
     /// Number of pages send from swap to frame table
     unsigned long numPagetoTLB;
+    /// Number of pages loaded ahead of time by fault-around
+    unsigned long numPagesPrefetched;
+    /// Number of pages mapped onto the shared zero frame
+    unsigned long numZeroPagesMapped;
+    /// Number of zero pages that got a frame of their own on first write
+    unsigned long numZeroPagesCopied;
+    /// Number of thread stacks mapped from the host
+    unsigned long numStacksAllocated;
+    /// Number of thread stacks taken from the pool of finished threads
+    unsigned long numStacksReused;
+    /// Number of times a thread had to wait for a lock
+    unsigned long numLockContentions;
     ///***
 
 #ifdef DFS_TICKS_FIX
@@ -67,6 +93,12 @@ public:
     unsigned long tickResets;
 #endif
 
+    /// Also print how fast the simulation ran on the host (`-ips`).
+    bool printSpeed;
+
+    /// Host time, in seconds, when the statistics started being collected.
+    double hostStartTime;
+
     /// Initialize everything to zero.
     Statistics();
 
@@ -95,6 +127,8 @@ const unsigned long CONSOLE_TIME  = 100;
   ///< Time to read or write one character.
 const unsigned long NETWORK_TIME  = 100;
   ///< Time to send or receive one packet.
+const unsigned long INPUT_CHECK_TIME = 100;
+  ///< Time between looks at the host for input to the devices.
 const unsigned long TIMER_TICKS   = 100;
   ///< (Average) time between timer interrupts.
 
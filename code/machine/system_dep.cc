@@ -28,6 +28,7 @@
 #include "threads/system.hh"
 
 extern "C" {
+#include <errno.h>
 #include <stdio.h>
 #include <string.h>
 #include <signal.h>
@@ -36,12 +37,16 @@ extern "C" {
 #include <sys/file.h>
 #include <sys/un.h>
 #include <sys/mman.h>
+#include <time.h>
 #ifdef HOST_i386
 #include <sys/time.h>
 #endif
 #ifdef HOST_LINUX
+#include <sys/epoll.h>
 #include <sys/syscall.h>
 #include <unistd.h>
+#else
+#include <sys/select.h>
 #endif
 
 /// UNIX routines called by procedures in this file
@@ -293,8 +298,9 @@ ReadFromSocket(int sockID, char *buffer, size_t packetSize)
 
 /// Transmit a fixed size packet to another Nachos' IPC port.
 ///
-/// Abort on error.
-void
+/// Return false if no Nachos is listening there (it has not started yet, or
+/// it already halted); abort on any other error.
+bool
 SendToSocket(int sockID, const char *buffer,
              size_t packetSize, const char *toName)
 {
@@ -314,7 +320,113 @@ SendToSocket(int sockID, const char *buffer,
                     (char *) &uName, sizeof uName);
 #endif
 
+    if (retVal < 0 && (errno == ENOENT || errno == ECONNREFUSED)) {
+        return false;
+    }
     ASSERT(retVal > 0 && retVal == (ssize_t) packetSize);
+    return true;
+}
+
+/// Read up to `count` fixed size packets off the IPC port, one after the
+/// other into `buffers`, without waiting for them.  Return how many were
+/// read.
+///
+/// On Linux this takes a single system call (`recvmmsg`), however many
+/// packets are waiting.
+unsigned
+ReadFromSocketBatch(int sockID, char *buffers,
+                    size_t packetSize, unsigned count)
+{
+    ASSERT(buffers != nullptr);
+    ASSERT(packetSize > 0);
+    ASSERT(count <= MAX_SOCKET_BATCH);
+
+#ifdef HOST_LINUX
+    struct mmsghdr messages[MAX_SOCKET_BATCH];
+    struct iovec   vectors[MAX_SOCKET_BATCH];
+    memset(messages, 0, count * sizeof *messages);
+    for (unsigned i = 0; i < count; i++) {
+        vectors[i].iov_base = buffers + i * packetSize;
+        vectors[i].iov_len  = packetSize;
+        messages[i].msg_hdr.msg_iov    = &vectors[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int retVal = recvmmsg(sockID, messages, count, MSG_DONTWAIT, nullptr);
+    if (retVal < 0) {
+        ASSERT(errno == EAGAIN || errno == EWOULDBLOCK);
+        return 0;
+    }
+    for (int i = 0; i < retVal; i++) {
+        ASSERT(messages[i].msg_len == packetSize);
+    }
+    return retVal;
+#else
+    unsigned read = 0;
+    while (read < count && PollSocket(sockID)) {
+        ReadFromSocket(sockID, buffers + read * packetSize, packetSize);
+        read++;
+    }
+    return read;
+#endif
+}
+
+/// Transmit `count` fixed size packets, one after the other in `buffers`,
+/// the `i`-th one to the IPC port called `toNames[i]`.  Return how many
+/// got somewhere; those for ports where no Nachos is listening are lost.
+///
+/// On Linux this takes a single system call (`sendmmsg`), unless some
+/// packet goes nowhere.
+unsigned
+SendToSocketBatch(int sockID, const char *buffers, size_t packetSize,
+                  const char *const *toNames, unsigned count)
+{
+    ASSERT(buffers != nullptr);
+    ASSERT(packetSize > 0);
+    ASSERT(toNames != nullptr);
+    ASSERT(count <= MAX_SOCKET_BATCH);
+
+#ifdef HOST_LINUX
+    struct mmsghdr     messages[MAX_SOCKET_BATCH];
+    struct iovec       vectors[MAX_SOCKET_BATCH];
+    struct sockaddr_un names[MAX_SOCKET_BATCH];
+    memset(messages, 0, count * sizeof *messages);
+    for (unsigned i = 0; i < count; i++) {
+        InitSocketName(&names[i], toNames[i]);
+        vectors[i].iov_base = (void *) (buffers + i * packetSize);
+        vectors[i].iov_len  = packetSize;
+        messages[i].msg_hdr.msg_name    = &names[i];
+        messages[i].msg_hdr.msg_namelen = sizeof names[i];
+        messages[i].msg_hdr.msg_iov     = &vectors[i];
+        messages[i].msg_hdr.msg_iovlen  = 1;
+    }
+
+    unsigned sent = 0, delivered = 0;
+    while (sent < count) {
+        int retVal = sendmmsg(sockID, &messages[sent], count - sent, 0);
+        if (retVal > 0) {
+            sent      += retVal;
+            delivered += retVal;
+            continue;
+        }
+        // The first one failed; find out why, and go on with the rest.
+        if (SendToSocket(sockID, buffers + sent * packetSize, packetSize,
+                         toNames[sent])) {
+            delivered++;
+        }
+        sent++;
+    }
+    return delivered;
+#else
+    unsigned delivered = 0;
+    for (unsigned i = 0; i < count; i++) {
+        if (SendToSocket(sockID, buffers + i * packetSize, packetSize,
+                         toNames[i])) {
+            delivered++;
+        }
+    }
+    return delivered;
+#endif
 }
 
 
@@ -329,6 +441,137 @@ CallOnUserAbort(VoidNoArgFunctionPtr func)
     signal(SIGINT, (SignalHandler) func);
 }
 
+#ifdef HOST_LINUX
+/// The epoll instance holding the watched files; created on first use.
+static int epollFd = -1;
+#else
+/// The files watched and not reported yet, and what to report for each.
+static int      watchedFds[MAX_WATCHED_FILES];
+static void    *watchedTags[MAX_WATCHED_FILES];
+static unsigned numWatched = 0;
+
+static void
+ForgetWatch(unsigned i)
+{
+    numWatched--;
+    watchedFds[i]  = watchedFds[numWatched];
+    watchedTags[i] = watchedTags[numWatched];
+}
+#endif
+
+/// Report `tag` the next time `fd` has something to read.  A watch goes off
+/// once; the file has to be watched again to hear about what comes next.
+///
+/// Return false if the file cannot be watched, which happens with regular
+/// files (on Linux); those always have something to read, or the end of
+/// the file.
+bool
+WatchInput(int fd, void *tag)
+{
+    ASSERT(fd >= 0);
+
+#ifdef HOST_LINUX
+    if (epollFd < 0) {
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        ASSERT(epollFd >= 0);
+    }
+    struct epoll_event event;
+    event.events   = EPOLLIN | EPOLLONESHOT;
+    event.data.ptr = tag;
+    if (epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event) == 0) {
+        return true;  // Watched before, so just arm it again.
+    }
+    ASSERT(errno == ENOENT);
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == 0) {
+        return true;
+    }
+    ASSERT(errno == EPERM);
+    return false;
+#else
+    UnwatchInput(fd);
+    ASSERT(numWatched < MAX_WATCHED_FILES);
+    watchedFds[numWatched]  = fd;
+    watchedTags[numWatched] = tag;
+    numWatched++;
+    return true;
+#endif
+}
+
+/// Stop watching `fd`, before closing it.
+void
+UnwatchInput(int fd)
+{
+#ifdef HOST_LINUX
+    if (epollFd >= 0 && epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr) != 0) {
+        ASSERT(errno == ENOENT);
+    }
+#else
+    for (unsigned i = 0; i < numWatched; i++) {
+        if (watchedFds[i] == fd) {
+            ForgetWatch(i);
+            break;
+        }
+    }
+#endif
+}
+
+/// Wait until a watched file has something to read, but no more than
+/// `milliseconds` (forever, if negative).  Put the tags of up to `max` of
+/// the files that are ready in `ready`, and return how many there are.
+///
+/// A signal may cut the wait short, with nothing ready.
+unsigned
+WaitForInput(int milliseconds, void **ready, unsigned max)
+{
+    ASSERT(ready != nullptr);
+
+    if (max > MAX_WATCHED_FILES) {
+        max = MAX_WATCHED_FILES;
+    }
+#ifdef HOST_LINUX
+    if (epollFd < 0) {
+        return 0;  // Nothing was ever watched.
+    }
+    struct epoll_event events[MAX_WATCHED_FILES];
+    int retVal = epoll_wait(epollFd, events, max, milliseconds);
+    if (retVal < 0) {
+        ASSERT(errno == EINTR);
+        return 0;
+    }
+    for (int i = 0; i < retVal; i++) {
+        ready[i] = events[i].data.ptr;
+    }
+    return retVal;
+#else
+    fd_set readable;
+    FD_ZERO(&readable);
+    int maxFd = -1;
+    for (unsigned i = 0; i < numWatched; i++) {
+        FD_SET(watchedFds[i], &readable);
+        maxFd = watchedFds[i] > maxFd ? watchedFds[i] : maxFd;
+    }
+    struct timeval waitTime;
+    waitTime.tv_sec  = milliseconds / 1000;
+    waitTime.tv_usec = milliseconds % 1000 * 1000;
+    int retVal = select(maxFd + 1, &readable, nullptr, nullptr,
+                        milliseconds < 0 ? nullptr : &waitTime);
+    if (retVal <= 0) {
+        ASSERT(retVal == 0 || errno == EINTR);
+        return 0;
+    }
+    unsigned found = 0;
+    for (unsigned i = 0; i < numWatched && found < max; ) {
+        if (FD_ISSET(watchedFds[i], &readable)) {
+            ready[found++] = watchedTags[i];
+            ForgetWatch(i);
+        } else {
+            i++;
+        }
+    }
+    return found;
+#endif
+}
+
 /// Put the UNIX process running Nachos to sleep for `seconds` seconds, to
 /// give the user time to start up another invocation of Nachos in a
 /// different UNIX shell.
@@ -338,6 +581,16 @@ Delay(unsigned seconds)
     sleep(seconds);
 }
 
+/// Uses a monotonic clock, so that the result is not thrown off by changes
+/// to the host's date.
+double
+HostTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
 /// Initialize the pseudo-random number generator.
 ///
 /// We use the now obsolete `srand` and `rand` because they are more
@@ -395,4 +648,45 @@ DeallocBoundedArray(const char *ptr, unsigned size)
     delete [] (ptr - pgSize);
 }
 
+/// Map a thread execution stack straight from the host, with one page
+/// right below it that cannot be touched at all.
+///
+/// Stacks grow downwards, so running off the bottom of the stack hits the
+/// guard page and the host raises a segmentation fault on the very access
+/// that overflowed, instead of silently trashing whatever lies below.
+///
+/// Returns the lowest usable address.
+///
+/// * `size` -- amount of useful space needed (in bytes); rounded up to
+///   whole pages.
+char *
+AllocGuardedStack(unsigned size)
+{
+    ASSERT(size > 0);
+
+    size_t pgSize = getpagesize();
+    size_t length = DivRoundUp(size_t(size), pgSize) * pgSize + pgSize;
+    void  *ptr    = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ASSERT(ptr != MAP_FAILED);
+
+    mprotect(ptr, pgSize, PROT_NONE);
+    return (char *) ptr + pgSize;
+}
+
+/// Unmap a stack obtained from `AllocGuardedStack`, guard page included.
+///
+/// * `ptr` is the lowest usable address of the stack.
+/// * `size` is the amount of useful space it was allocated with (in bytes).
+void
+DeallocGuardedStack(char *ptr, unsigned size)
+{
+    ASSERT(ptr != nullptr);
+    ASSERT(size > 0);
+
+    size_t pgSize = getpagesize();
+    size_t length = DivRoundUp(size_t(size), pgSize) * pgSize + pgSize;
+    munmap(ptr - pgSize, length);
+}
+
 };
@@ -59,13 +59,40 @@ namespace SystemDep {
 
     void ReadFromSocket(int sockID, char *buffer, size_t packetSize);
 
-    void SendToSocket(int sockID, const char *buffer,
+    bool SendToSocket(int sockID, const char *buffer,
                       size_t packetSize, const char *toName);
 
+    /// Packets moved by a single call of the batch operations, at most.
+    const unsigned MAX_SOCKET_BATCH = 32;
+
+    unsigned ReadFromSocketBatch(int sockID, char *buffers,
+                                 size_t packetSize, unsigned count);
+
+    unsigned SendToSocketBatch(int sockID, const char *buffers,
+                               size_t packetSize,
+                               const char *const *toNames, unsigned count);
+
+    /// Device multiplexer: waits on several files and sockets at once, for
+    /// whichever has something to read first.  For the interrupt
+    /// simulation, to sleep while the devices have nothing to do.
+
+    /// Files watched at the same time, at most.
+    const unsigned MAX_WATCHED_FILES = 16;
+
+    bool WatchInput(int fd, void *tag);
+
+    void UnwatchInput(int fd);
+
+    unsigned WaitForInput(int milliseconds, void **ready, unsigned max);
+
     /// Process control: `sleep`.
 
     void Delay(unsigned seconds);
 
+    /// Seconds elapsed on the host since some fixed point in the past, for
+    /// measuring how long the simulation itself takes.
+    double HostTime();
+
     /// Initialize system so that `cleanUp` routine is called when user hits
     /// Ctrl-C.
     void CallOnUserAbort(VoidNoArgFunctionPtr cleanUp);
@@ -81,6 +108,13 @@ namespace SystemDep {
     char *AllocBoundedArray(unsigned size);
 
     void DeallocBoundedArray(const char *p, unsigned size);
+
+    /// Allocate, de-allocate a thread stack with an inaccessible guard page
+    /// just below it.
+
+    char *AllocGuardedStack(unsigned size);
+
+    void DeallocGuardedStack(char *p, unsigned size);
 };
 
 
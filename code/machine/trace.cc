@@ -0,0 +1,101 @@
+/// Routines to record events into a ring buffer and save them.
+///
+/// Copyright (c) 2016-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "trace.hh"
+
+#include <string.h>
+
+
+Tracer::Tracer(const unsigned long *clock_, unsigned capacity)
+{
+    ASSERT(clock_ != nullptr);
+    ASSERT(capacity > 0 && (capacity & (capacity - 1)) == 0);
+
+    clock     = clock_;
+    events    = new traceEvent [capacity];
+    mask      = capacity - 1;
+    count     = 0;
+    running   = 0;
+    names     = new traceName [TRACE_MAX_NAMES];
+    numNames  = 0;
+    threadIds = 0;
+    lockIds   = 0;
+}
+
+Tracer::~Tracer()
+{
+    delete [] events;
+    delete [] names;
+}
+
+unsigned
+Tracer::NewThread(const char *name)
+{
+    unsigned id = threadIds++;
+    AddName(TRACE_NAME_THREAD, id, name);
+    return id;
+}
+
+unsigned
+Tracer::NewLock(const char *name)
+{
+    unsigned id = lockIds++;
+    AddName(TRACE_NAME_LOCK, id, name);
+    return id;
+}
+
+void
+Tracer::AddName(unsigned kind, unsigned id, const char *name)
+{
+    if (numNames == TRACE_MAX_NAMES) {
+        return;
+    }
+    traceName *n = &names[numNames++];
+    n->kind = kind;
+    n->id   = id;
+    strncpy(n->name, name != nullptr ? name : "(null)", TRACE_NAME_SIZE - 1);
+    n->name[TRACE_NAME_SIZE - 1] = '\0';
+}
+
+/// The events go out oldest first, straightening the ring.
+void
+Tracer::Write(const char *path) const
+{
+    ASSERT(path != nullptr);
+
+    unsigned long capacity = (unsigned long) mask + 1;
+    unsigned long kept = count < capacity ? count : capacity;
+
+    traceHeader header;
+    header.magic     = TRACE_MAGIC;
+    header.version   = TRACE_VERSION;
+    header.numEvents = kept;
+    header.numNames  = numNames;
+    header.lost      = count - kept;
+
+    int fd = SystemDep::OpenForWrite(path);
+    SystemDep::WriteFile(fd, (const char *) &header, sizeof header);
+
+    unsigned long first = count - kept;
+    unsigned long split = capacity - (first & mask);  // Events up to the end.
+    if (split > kept) {
+        split = kept;
+    }
+    if (split > 0) {
+        SystemDep::WriteFile(fd, (const char *) &events[first & mask],
+                             split * sizeof (traceEvent));
+    }
+    if (kept > split) {
+        SystemDep::WriteFile(fd, (const char *) events,
+                             (kept - split) * sizeof (traceEvent));
+    }
+    if (numNames > 0) {
+        SystemDep::WriteFile(fd, (const char *) names,
+                             numNames * sizeof (traceName));
+    }
+    SystemDep::Close(fd);
+}
@@ -0,0 +1,100 @@
+/// Data structures to record what happens during a run, for later study.
+///
+/// The tracer keeps the last events in a ring buffer of fixed size, with
+/// the simulated time at which they happened.  Recording an event is a few
+/// stores into the ring, so tracing can be left on; when the ring fills up
+/// the oldest events are overwritten.  At the end of the run the ring is
+/// written to a file in the format described in `bin/trace.h`, which
+/// `bin/trace2json` turns into JSON for the Chrome trace viewer or
+/// Perfetto.
+///
+/// Copyright (c) 2016-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_MACHINE_TRACE__HH
+#define NACHOS_MACHINE_TRACE__HH
+
+
+#include "bin/trace.h"
+#include "lib/utility.hh"
+
+
+/// Events kept by default; must be a power of two.
+const unsigned TRACE_DEFAULT_EVENTS = 64 * 1024;
+
+/// Names kept for threads and locks; later ones go unnamed.
+const unsigned TRACE_MAX_NAMES = 1024;
+
+class Tracer {
+public:
+
+    /// Keep the last `capacity` events, stamped with the time in `clock`.
+    Tracer(const unsigned long *clock,
+           unsigned capacity = TRACE_DEFAULT_EVENTS);
+
+    ~Tracer();
+
+    /// The current simulated time, to pass later to `RecordSince`.
+    unsigned long Now() const
+    {
+        return *clock;
+    }
+
+    /// Record an event happening now.
+    void Record(unsigned type, unsigned arg0 = 0, unsigned arg1 = 0)
+    {
+        Append(*clock, type, arg0, arg1);
+    }
+
+    /// Record an event that began at `start` and ends now.
+    void RecordSince(unsigned type, unsigned long start, unsigned arg0)
+    {
+        Append(start, type, arg0, (unsigned) (*clock - start));
+    }
+
+    /// Thread `thread` starts running.
+    void Switch(unsigned thread)
+    {
+        unsigned previous = running;
+        running = thread;
+        Record(TRACE_SWITCH, previous);
+    }
+
+    /// Get ids for a new thread or lock, remembering its name.
+    unsigned NewThread(const char *name);
+    unsigned NewLock(const char *name);
+
+    /// Write everything in the ring to the file `path`.
+    void Write(const char *path) const;
+
+private:
+
+    void Append(unsigned long tick, unsigned type,
+                unsigned arg0, unsigned arg1)
+    {
+        traceEvent *e = &events[count++ & mask];
+        e->tick   = tick;
+        e->type   = type;
+        e->thread = running;
+        e->arg0   = arg0;
+        e->arg1   = arg1;
+    }
+
+    void AddName(unsigned kind, unsigned id, const char *name);
+
+    const unsigned long *clock;
+
+    traceEvent *events;
+    unsigned mask;        ///< Capacity of `events` minus one.
+    unsigned long count;  ///< Events ever recorded.
+    unsigned running;     ///< Thread that events are charged to.
+
+    traceName *names;
+    unsigned numNames;
+    unsigned threadIds;   ///< Thread ids handed out.
+    unsigned lockIds;     ///< Lock ids handed out.
+};
+
+
+#endif
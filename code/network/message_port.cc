@@ -0,0 +1,216 @@
+/// Copyright (c) 2016-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "message_port.hh"
+#include "threads/system.hh"
+
+#include <string.h>
+
+
+/// Fragments in a message, at most.
+static const unsigned MAX_FRAGMENTS =
+    (MAX_PORT_MESSAGE_SIZE + PORT_FRAGMENT_SIZE - 1) / PORT_FRAGMENT_SIZE;
+static_assert(MAX_FRAGMENTS < 32, "the fragments received have 32 bits");
+
+/// Ports by mail box; allocated when the first one is bound.
+static MessagePort **ports = nullptr;
+
+/// Mail left in the box from an earlier owner is thrown away.
+MessagePort *
+MessagePort::Bind(MailBoxAddress box, AddressSpace *owner)
+{
+    int numBoxes = postOffice->GetNumBoxes();
+    if (box < 0 || box >= numBoxes) {
+        return nullptr;
+    }
+    if (ports == nullptr) {
+        ports = new MessagePort *[numBoxes];
+        memset(ports, 0, numBoxes * sizeof *ports);
+    }
+    if (ports[box] != nullptr) {
+        return nullptr;
+    }
+
+    Mail *stale;
+    while ((stale = postOffice->ReceiveMail(box, 0)) != nullptr) {
+        delete stale;
+    }
+    ports[box] = new MessagePort(box, owner);
+    DEBUG('n', "Mail box %d bound\n", box);
+    return ports[box];
+}
+
+MessagePort *
+MessagePort::Lookup(MailBoxAddress box, AddressSpace *owner)
+{
+    if (ports == nullptr || box < 0 || box >= postOffice->GetNumBoxes()
+          || ports[box] == nullptr || ports[box]->owner != owner) {
+        return nullptr;
+    }
+    return ports[box];
+}
+
+/// Called when the address space is deleted, with interrupts off, so it
+/// only frees memory.
+void
+MessagePort::Unbind(AddressSpace *owner)
+{
+    if (ports == nullptr) {
+        return;
+    }
+    for (int box = 0; box < postOffice->GetNumBoxes(); box++) {
+        if (ports[box] != nullptr && ports[box]->owner == owner) {
+            DEBUG('n', "Mail box %d unbound\n", box);
+            delete ports[box];
+            ports[box] = nullptr;
+        }
+    }
+}
+
+MessagePort::MessagePort(MailBoxAddress box_, AddressSpace *owner_)
+{
+    box    = box_;
+    owner  = owner_;
+    nextId = 0;
+    lock   = new Lock("message port");
+    for (unsigned i = 0; i < PORT_PARTIAL_MESSAGES; i++) {
+        partials[i].used = false;
+    }
+}
+
+MessagePort::~MessagePort()
+{
+    delete lock;
+}
+
+void
+MessagePort::Send(NetworkAddress toAddr, MailBoxAddress toBox,
+                  const char *data, unsigned size)
+{
+    ASSERT(data != nullptr || size == 0);
+    ASSERT(size <= MAX_PORT_MESSAGE_SIZE);
+
+    unsigned count = size == 0 ? 1
+                               : (size + PORT_FRAGMENT_SIZE - 1)
+                                 / PORT_FRAGMENT_SIZE;
+    unsigned short id = nextId++;
+    for (unsigned i = 0; i < count; i++) {
+        unsigned offset = i * PORT_FRAGMENT_SIZE;
+        unsigned length = size - offset < PORT_FRAGMENT_SIZE
+                          ? size - offset : PORT_FRAGMENT_SIZE;
+
+        Mail mail;
+        FragmentHeader *header = (FragmentHeader *) mail.data;
+        header->id    = id;
+        header->index = i;
+        header->count = count;
+        memcpy(mail.data + sizeof *header, data + offset, length);
+
+        mail.pktHdr.to      = toAddr;
+        mail.mailHdr.to     = toBox;
+        mail.mailHdr.from   = box;
+        mail.mailHdr.length = sizeof *header + length;
+        postOffice->SendMail(&mail);
+    }
+}
+
+int
+MessagePort::Receive(char *data, long timeout,
+                     NetworkAddress *fromAddr, MailBoxAddress *fromBox)
+{
+    ASSERT(data != nullptr);
+    ASSERT(fromAddr != nullptr && fromBox != nullptr);
+
+    lock->Acquire();
+    unsigned long start = stats->totalTicks;
+    int length = -1;
+    while (length < 0) {
+        Mail *mail;
+        if (timeout < 0) {
+            mail = postOffice->ReceiveMail(box);
+        } else {
+            unsigned long waited = stats->totalTicks - start;
+            mail = postOffice->ReceiveMail(box,
+                waited < (unsigned long) timeout ? timeout - waited : 0);
+            if (mail == nullptr) {
+                break;
+            }
+        }
+
+        Partial *message = Assemble(mail);
+        if (message != nullptr) {
+            memcpy(data, message->data, message->length);
+            length    = message->length;
+            *fromAddr = message->fromAddr;
+            *fromBox  = message->fromBox;
+            message->used = false;
+        }
+        delete mail;
+    }
+    lock->Release();
+    return length;
+}
+
+/// Fragments that do not make sense are dropped.  When every message being
+/// put together is still missing something, the oldest one is given up.
+MessagePort::Partial *
+MessagePort::Assemble(const Mail *mail)
+{
+    ASSERT(mail != nullptr);
+
+    const FragmentHeader *header = (const FragmentHeader *) mail->data;
+    if (mail->mailHdr.length < sizeof *header || header->count == 0
+          || header->count > MAX_FRAGMENTS || header->index >= header->count) {
+        DEBUG('n', "Bad fragment in mail box %d, dropped\n", box);
+        return nullptr;
+    }
+    unsigned offset = header->index * PORT_FRAGMENT_SIZE;
+    unsigned length = mail->mailHdr.length - sizeof *header;
+    if (offset + length > MAX_PORT_MESSAGE_SIZE) {
+        DEBUG('n', "Bad fragment in mail box %d, dropped\n", box);
+        return nullptr;
+    }
+
+    Partial *message = nullptr;
+    for (unsigned i = 0; i < PORT_PARTIAL_MESSAGES; i++) {
+        Partial *p = &partials[i];
+        if (p->used && p->fromAddr == mail->pktHdr.from
+              && p->fromBox == mail->mailHdr.from && p->id == header->id) {
+            message = p;
+            break;
+        }
+        if (message == nullptr || (message->used
+                                   && (!p->used
+                                       || p->started < message->started))) {
+            message = p;
+        }
+    }
+    if (!message->used || message->id != header->id
+          || message->fromAddr != mail->pktHdr.from
+          || message->fromBox != mail->mailHdr.from) {
+        if (message->used) {
+            DEBUG('n', "Message %u in mail box %d incomplete, given up\n",
+                  message->id, box);
+        }
+        message->used     = true;
+        message->fromAddr = mail->pktHdr.from;
+        message->fromBox  = mail->mailHdr.from;
+        message->id       = header->id;
+        message->count    = header->count;
+        message->received = 0;
+        message->length   = 0;
+        message->started  = stats->totalTicks;
+    }
+
+    memcpy(message->data + offset, mail->data + sizeof *header, length);
+    message->received |= 1u << header->index;
+    if (header->index == message->count - 1) {
+        message->length = offset + length;
+    }
+    if (message->received != (1u << message->count) - 1) {
+        return nullptr;
+    }
+    return message;
+}
@@ -0,0 +1,112 @@
+/// Mailboxes bound by user programs, carrying messages of up to a page.
+///
+/// A user program binds a mailbox of this machine to send from and receive
+/// at (see `Bind`, `Send` and `Receive` in `userprog/syscall.h`).  Mails
+/// are much smaller than a page, so a message is cut into fragments, each
+/// one a mail starting with a `FragmentHeader`; the receiving port puts
+/// them back together.  As with single mails, messages can be lost (when
+/// any of their fragments is), but never corrupted.
+///
+/// Fragments of messages from different senders can arrive mixed up, so a
+/// port puts together up to `PORT_PARTIAL_MESSAGES` messages at a time; a
+/// message that cannot be finished because one of its fragments was lost
+/// is given up when room is needed for a newer one.
+///
+/// Copyright (c) 2016-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_NETWORK_MESSAGEPORT__HH
+#define NACHOS_NETWORK_MESSAGEPORT__HH
+
+
+#include "post.hh"
+#include "machine/mmu.hh"
+#include "threads/lock.hh"
+
+
+class AddressSpace;
+
+/// The following class defines the header a `MessagePort` prepends to the
+/// data of each mail.
+class FragmentHeader {
+public:
+    unsigned short id;     ///< Number of the message, for its sender.
+    unsigned char  index;  ///< Number of the fragment in the message.
+    unsigned char  count;  ///< Fragments in the message.
+};
+
+/// Data in a message, at most.
+const unsigned MAX_PORT_MESSAGE_SIZE = PAGE_SIZE;
+
+/// Data carried by a single fragment.
+const unsigned PORT_FRAGMENT_SIZE = MAX_MAIL_SIZE - sizeof (FragmentHeader);
+
+/// Messages put together at the same time by a port, at most.
+const unsigned PORT_PARTIAL_MESSAGES = 4;
+
+/// The following class defines a mailbox bound by a user program.
+///
+/// Ports are created by `Bind`, and live until their owner's address space
+/// is deleted.  One thread at a time receives at a port.
+class MessagePort {
+public:
+
+    /// Bind mail box `box` for `owner`.  Return the new port, or null if
+    /// there is no such box or it was already bound.
+    static MessagePort *Bind(MailBoxAddress box, AddressSpace *owner);
+
+    /// Return the port of `box`, if `owner` bound it; null otherwise.
+    static MessagePort *Lookup(MailBoxAddress box, AddressSpace *owner);
+
+    /// Free every port bound by `owner`.
+    static void Unbind(AddressSpace *owner);
+
+    /// Send `size` bytes of `data`, at most `MAX_PORT_MESSAGE_SIZE`, to
+    /// mail box `toBox` of machine `toAddr`.
+    void Send(NetworkAddress toAddr, MailBoxAddress toBox,
+              const char *data, unsigned size);
+
+    /// Wait up to `timeout` ticks (not at all if 0, forever if negative)
+    /// for a whole message, and copy it into `data`, which must have room
+    /// for `MAX_PORT_MESSAGE_SIZE` bytes.  Return its length, or -1 if no
+    /// message came; its sender goes in `fromAddr` and `fromBox`.
+    int Receive(char *data, long timeout,
+                NetworkAddress *fromAddr, MailBoxAddress *fromBox);
+
+private:
+
+    MessagePort(MailBoxAddress box, AddressSpace *owner);
+
+    ~MessagePort();
+
+    /// A message being put together.
+    struct Partial {
+        bool           used;
+        NetworkAddress fromAddr;
+        MailBoxAddress fromBox;
+        unsigned short id;
+        unsigned       count;     ///< Fragments expected.
+        unsigned       received;  ///< Bit `i` set if fragment `i` arrived.
+        unsigned       length;    ///< Known once the last one arrived.
+        unsigned long  started;   ///< Ticks when the first one arrived.
+        char           data[MAX_PORT_MESSAGE_SIZE];
+    };
+
+    /// Put the fragment in `mail` in its place.  Return the message if it
+    /// is now complete.
+    Partial *Assemble(const Mail *mail);
+
+    MailBoxAddress box;
+    AddressSpace *owner;
+
+    /// Number of the next message sent.
+    unsigned short nextId;
+
+    /// Protects the messages being put together.
+    Lock *lock;
+    Partial partials[PORT_PARTIAL_MESSAGES];
+};
+
+
+#endif
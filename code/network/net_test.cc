@@ -18,8 +18,11 @@
 /// limitation of liability and disclaimer of warranty provisions.
 
 
+#include "message_port.hh"
 #include "network.hh"
 #include "post.hh"
+#include "shared_memory.hh"
+#include "transport.hh"
 #include "machine/interrupt.hh"
 #include "threads/system.hh"
 
@@ -76,3 +79,269 @@ MailTest(int farAddr)
     // Then we are done!
     interrupt->Halt();
 }
+
+/// Mails each machine sends in `MailRateTest`.
+static const unsigned MAIL_RATE_COUNT = 20000;
+
+static void
+RateReceiver(void *arg)
+{
+    PacketHeader pktHdr;
+    MailHeader   mailHdr;
+    char buffer[MAX_MAIL_SIZE];
+
+    for (unsigned i = 0; i < MAIL_RATE_COUNT; i++) {
+        postOffice->Receive(0, &pktHdr, &mailHdr, buffer);
+    }
+}
+
+/// Measure how many mails per second go through the post office: send
+/// `MAIL_RATE_COUNT` small mails to mailbox 0 of `farAddr` as fast as
+/// possible, while receiving as many.  Run it with `-ips` to see how long
+/// it took on the host; if `farAddr` is this machine, it talks to itself.
+void
+MailRateTest(int farAddr)
+{
+    unsigned long start = stats->totalTicks;
+    Thread *receiver = new Thread("mail rate receiver", true);
+    receiver->Fork(RateReceiver, nullptr);
+
+    PacketHeader pktHdr;
+    MailHeader   mailHdr;
+    char data[16] = "0123456789abcde";
+    pktHdr.to      = farAddr;
+    mailHdr.to     = 0;
+    mailHdr.from   = 1;
+    mailHdr.length = sizeof data;
+    for (unsigned i = 0; i < MAIL_RATE_COUNT; i++) {
+        postOffice->Send(pktHdr, mailHdr, data);
+    }
+    receiver->Join();
+
+    printf("Mail rate: %u mails each way in %lu ticks\n",
+           MAIL_RATE_COUNT, stats->totalTicks - start);
+    fflush(stdout);
+    interrupt->Halt();
+}
+
+/// Bytes of the message each end sends in `TransportTest`: many fragments,
+/// so that the window fills.
+static const unsigned TRANSPORT_TEST_SIZE = 2048;
+
+/// One end of the exchange in `TransportTest`.
+struct TransportEnd {
+    Connection    *conn;
+    MailBoxAddress localBox;
+    MailBoxAddress farBox;
+    bool           ok;
+};
+
+/// Each end fills its message after its own mailbox, so that it can check
+/// that it got the other one.
+static void
+FillMessage(char *data, MailBoxAddress box)
+{
+    for (unsigned i = 0; i < TRANSPORT_TEST_SIZE; i++) {
+        data[i] = 'a' + (i * 7 + box) % 26;
+    }
+}
+
+static void
+Exchange(void *arg)
+{
+    ASSERT(arg != nullptr);
+    TransportEnd *end = (TransportEnd *) arg;
+    char *sent     = new char [TRANSPORT_TEST_SIZE];
+    char *received = new char [TRANSPORT_TEST_SIZE];
+
+    FillMessage(sent, end->localBox);
+    end->conn->Send(sent, TRANSPORT_TEST_SIZE);
+    unsigned length = end->conn->Receive(received, TRANSPORT_TEST_SIZE);
+    FillMessage(sent, end->farBox);
+    end->ok = length == TRANSPORT_TEST_SIZE
+              && memcmp(sent, received, TRANSPORT_TEST_SIZE) == 0;
+    end->conn->Flush();
+
+    delete [] sent;
+    delete [] received;
+}
+
+static void
+WakeUp(void *arg)
+{
+    ASSERT(arg != nullptr);
+    ((Semaphore *) arg)->V();
+}
+
+/// Test out the reliable transport, and report its goodput: each end sends
+/// a message of `TRANSPORT_TEST_SIZE` bytes to the other one, and checks
+/// the one it gets.
+///
+/// With `-n`, the network loses packets, and the transport has to send
+/// them again.  If `farAddr` is this machine, both ends run here, in
+/// different mailboxes, and nothing else needs to be started.
+void
+TransportTest(int farAddr)
+{
+    NetworkAddress self = postOffice->GetAddress();
+    bool loopback = farAddr == self;
+    unsigned long start = stats->totalTicks;
+
+    TransportEnd here = { nullptr, 2, (MailBoxAddress) (loopback ? 3 : 2),
+                          false };
+    here.conn = new Connection(here.localBox, farAddr, here.farBox);
+    if (loopback) {
+        TransportEnd there = { nullptr, 3, 2, false };
+        there.conn = new Connection(there.localBox, self, there.farBox);
+        Thread *t = new Thread("transport test", true);
+        t->Fork(Exchange, &there);
+        Exchange(&here);
+        t->Join();
+        here.ok = here.ok && there.ok;
+    } else {
+        Exchange(&here);
+    }
+
+    unsigned long ticks = stats->totalTicks - start;
+    unsigned bytes = (loopback ? 2 : 1) * TRANSPORT_TEST_SIZE;
+    printf("Transport test %s: received %u bytes in %lu ticks, "
+           "goodput %.1f bytes per 1000 ticks\n",
+           here.ok ? "passed" : "FAILED", bytes, ticks,
+           1000.0 * bytes / ticks);
+    fflush(stdout);
+
+    // The other end may not have our last acknowledgement yet; stay around
+    // to answer its retransmissions, until nothing arrives for a while.  An
+    // idle machine runs through simulated time without waiting, so the
+    // other machine gets a second of real time too.
+    Semaphore *quiet = new Semaphore("transport linger", 0);
+    unsigned long packets;
+    do {
+        packets = stats->numPacketsRecvd;
+        if (!loopback) {
+            SystemDep::Delay(1);
+        }
+        IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+        interrupt->Schedule(WakeUp, quiet, 2 * MAX_RETRANSMIT_TIMEOUT,
+                            TRANSPORT_INT);
+        interrupt->SetLevel(oldLevel);
+        quiet->P();
+    } while (stats->numPacketsRecvd != packets);
+    delete quiet;
+    interrupt->Halt();
+}
+
+/// Sizes of the messages each machine sends in `PortTest`: a whole page,
+/// a few fragments, a single one, and no data at all.
+static const unsigned PORT_TEST_SIZES[] = {
+    MAX_PORT_MESSAGE_SIZE, 50, 1, 0
+};
+static const unsigned PORT_TEST_COUNT =
+    sizeof PORT_TEST_SIZES / sizeof *PORT_TEST_SIZES;
+
+static const MailBoxAddress PORT_TEST_BOX = 2;
+
+/// Ticks `PortTest` waits for a message that never comes.
+static const long PORT_TEST_TIMEOUT = 5000;
+
+/// Test the message ports that user programs use: send messages of several
+/// sizes to the port of `farAddr` and check those that come back, then
+/// wait for one more with a timeout.  If `farAddr` is this machine, it
+/// talks to itself.
+void
+PortTest(int farAddr)
+{
+    MessagePort *port = MessagePort::Bind(PORT_TEST_BOX, nullptr);
+    ASSERT(port != nullptr);
+    ASSERT(MessagePort::Bind(PORT_TEST_BOX, nullptr) == nullptr);
+
+    char data[MAX_PORT_MESSAGE_SIZE];
+    for (unsigned i = 0; i < PORT_TEST_COUNT; i++) {
+        for (unsigned j = 0; j < PORT_TEST_SIZES[i]; j++) {
+            data[j] = 'a' + (i + j) % 26;
+        }
+        port->Send(farAddr, PORT_TEST_BOX, data, PORT_TEST_SIZES[i]);
+    }
+
+    NetworkAddress fromAddr;
+    MailBoxAddress fromBox;
+    for (unsigned i = 0; i < PORT_TEST_COUNT; i++) {
+        int length = port->Receive(data, -1, &fromAddr, &fromBox);
+        ASSERT(length == (int) PORT_TEST_SIZES[i]);
+        ASSERT(fromAddr == farAddr && fromBox == PORT_TEST_BOX);
+        for (int j = 0; j < length; j++) {
+            ASSERT(data[j] == (char) ('a' + (i + j) % 26));
+        }
+    }
+
+    unsigned long start = stats->totalTicks;
+    ASSERT(port->Receive(data, PORT_TEST_TIMEOUT, &fromAddr, &fromBox) == -1);
+    unsigned long waited = stats->totalTicks - start;
+    ASSERT(waited >= (unsigned long) PORT_TEST_TIMEOUT);
+
+    printf("Port test passed: %u messages each way, gave up waiting for"
+           " another after %lu ticks\n", PORT_TEST_COUNT, waited);
+    fflush(stdout);
+    interrupt->Halt();
+}
+
+/// Turns each machine takes in `SharedMemoryTest`.
+static const unsigned SHARED_TEST_ROUNDS = 20;
+
+/// Ticks without mail after which `SharedMemoryTest` stops serving the
+/// other machines.
+static const unsigned long SHARED_TEST_LINGER = 100000;
+
+/// Test the distributed shared memory.  The machines take turns adding one
+/// to a counter in the first page of the region; in its turn, each one also
+/// writes the counter in one of the other pages, so that pages move around
+/// and copies get invalidated.  In the end, every machine checks every
+/// page.
+void
+SharedMemoryTest()
+{
+    ASSERT(sharedMemory != nullptr);
+
+    unsigned machines = sharedMemory->GetMachines();
+    unsigned turns  = machines * SHARED_TEST_ROUNDS;
+    unsigned others = SHARED_MEMORY_PAGES - 1;
+    for (unsigned turn = postOffice->GetAddress(); turn < turns;
+         turn += machines) {
+        while ((unsigned) sharedMemory->Load(0) != turn) {
+            currentThread->Yield();
+        }
+        sharedMemory->Store(PAGE_SIZE * (1 + turn % others), turn);
+        sharedMemory->Store(0, turn + 1);
+    }
+    while ((unsigned) sharedMemory->Load(0) != turns) {
+        currentThread->Yield();
+    }
+
+    // Page `1 + p` holds the last turn `t` with `t % others == p`.
+    for (unsigned p = 0; p < others; p++) {
+        int expected = 0;
+        for (unsigned turn = p; turn < turns; turn += others) {
+            expected = turn;
+        }
+        ASSERT(sharedMemory->Load(PAGE_SIZE * (1 + p)) == expected);
+    }
+    printf("Shared memory test passed: %u turns on %u machines\n",
+           turns, machines);
+    fflush(stdout);
+
+    // Other machines may still need pages from this one: keep serving them
+    // until nothing arrives for a while.  An idle machine runs through
+    // simulated time without waiting, so they get a second of real time
+    // too.
+    Semaphore *quiet = new Semaphore("shared memory linger", 0);
+    unsigned long packets;
+    do {
+        packets = stats->numPacketsRecvd;
+        if (machines > 1) {
+            SystemDep::Delay(1);
+        }
+        quiet->P(SHARED_TEST_LINGER);
+    } while (stats->numPacketsRecvd != packets);
+    delete quiet;
+    interrupt->Halt();
+}
@@ -19,11 +19,24 @@
 
 
 #include "post.hh"
+#include "threads/system.hh"
 
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 
 
+static_assert(offsetof(Mail, data)
+                == offsetof(Mail, mailHdr) + sizeof (MailHeader),
+              "the network carries the mail header and data together");
+
+Mail *Mail::freeMails = nullptr;
+
+Mail::Mail()
+{
+    mailHdr.length = 0;
+}
+
 /// Initialize a single mail message, by concatenating the headers to
 /// the data.
 ///
@@ -40,13 +53,42 @@ Mail::Mail(PacketHeader pktH, MailHeader mailH, const char *msgData)
     memmove(data, msgData, mailHdr.length);
 }
 
+/// Interrupts are disabled while the pool changes, because the interrupt
+/// handler of the network takes mails from it.
+void *
+Mail::operator new(size_t size)
+{
+    ASSERT(size == sizeof (Mail));
+
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    Mail *mail = freeMails;
+    if (mail != nullptr) {
+        freeMails = *(Mail **) mail;
+    }
+    interrupt->SetLevel(oldLevel);
+    return mail != nullptr ? mail : ::operator new(size);
+}
+
+void
+Mail::operator delete(void *p)
+{
+    if (p == nullptr) {
+        return;
+    }
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    *(Mail **) p = freeMails;
+    freeMails = (Mail *) p;
+    interrupt->SetLevel(oldLevel);
+}
+
 /// Initialize a single mail box within the post office, so that it can
 /// receive incoming messages.
 ///
 /// Just initialize a list of messages, representing the mailbox.
 MailBox::MailBox()
 {
-    messages = new SynchList<Mail *>;
+    messages  = new SynchList<Mail *>;
+    available = new Semaphore("mail available", 0);
 }
 
 /// De-allocate a single mail box within the post office.
@@ -56,6 +98,7 @@ MailBox::MailBox()
 MailBox::~MailBox()
 {
     delete messages;
+    delete available;
 }
 
 /// Print the message header -- the destination machine ID and mailbox
@@ -74,20 +117,15 @@ PrintHeader(PacketHeader pktHdr, MailHeader mailHdr)
 ///
 /// If anyone is waiting for message arrival, wake them up!
 ///
-/// We need to reconstruct the `Mail` message (by concatenating the headers
-/// to the data), to simplify queueing the message on the `SynchList`.
-///
-/// * `pktHdr` -- source, destination machine ID's.
-/// * `mailHdr` -- source, destination mailbox ID's.
-/// * `data` is the payload message data.
+/// * `mail` is the message, as it came from the network.
 void
-MailBox::Put(PacketHeader pktHdr, MailHeader mailHdr, const char *data)
+MailBox::Put(Mail *mail)
 {
-    ASSERT(data != nullptr);
+    ASSERT(mail != nullptr);
 
-    Mail *mail = new Mail(pktHdr, mailHdr, data);
     messages->Append(mail);  // Put on the end of the list of arrived
                              // messages, and wake up any waiters.
+    available->V();
 }
 
 /// Get a message from a mailbox, parsing it into the packet header, mailbox
@@ -105,22 +143,38 @@ MailBox::Get(PacketHeader *pktHdr, MailHeader *mailHdr, char *data)
     ASSERT(mailHdr != nullptr);
     ASSERT(data != nullptr);
 
-    DEBUG('n', "Waiting for mail in mailbox\n");
-    Mail *mail = messages->Pop();  // Remove message from list;
-                                   // will wait if list is empty.
-
+    Mail *mail = GetMail();
     *pktHdr  = mail->pktHdr;
     *mailHdr = mail->mailHdr;
-    if (debug.IsEnabled('n')) {
-        printf("Got mail from mailbox: ");
-        PrintHeader(*pktHdr, *mailHdr);
-    }
     memmove(data, mail->data, mail->mailHdr.length);
       // Copy the message data into the caller's buffer.
     delete mail;  // We have copied out the stuff we need, we can now discard
                   // the message.
 }
 
+Mail *
+MailBox::GetMail()
+{
+    DEBUG('n', "Waiting for mail in mailbox\n");
+    available->P();
+    Mail *mail = messages->Pop();  // Remove message from list.
+    if (debug.IsEnabled('n')) {
+        printf("Got mail from mailbox: ");
+        PrintHeader(mail->pktHdr, mail->mailHdr);
+    }
+    return mail;
+}
+
+Mail *
+MailBox::GetMail(unsigned long timeout)
+{
+    DEBUG('n', "Waiting for mail in mailbox, up to %lu ticks\n", timeout);
+    if (!available->P(timeout)) {
+        return nullptr;
+    }
+    return messages->Pop();
+}
+
 /// PostalHelper, ReadAvail, WriteDone
 ///
 /// Dummy functions because C++ cannot indirectly invoke member functions.
@@ -175,8 +229,8 @@ PostOffice::PostOffice(NetworkAddress addr, double reliability, int nBoxes)
 
     // First, initialize the synchronization with the interrupt handlers.
     messageAvailable = new Semaphore("message available", 0);
-    messageSent      = new Semaphore("message sent", 0);
-    sendLock         = new Lock("message send lock");
+    receiveStalled   = false;
+    transmitSlots    = new Semaphore("transmit slots", NETWORK_QUEUE_SIZE);
 
     // Second, initialize the mailboxes.
     netAddr  = addr;
@@ -200,8 +254,7 @@ PostOffice::~PostOffice()
     delete network;
     delete [] boxes;
     delete messageAvailable;
-    delete messageSent;
-    delete sendLock;
+    delete transmitSlots;
 }
 
 /// Wait for incoming messages, and put them in the right mailbox.
@@ -211,27 +264,33 @@ PostOffice::~PostOffice()
 void
 PostOffice::PostalDelivery()
 {
-    PacketHeader pktHdr;
-    MailHeader   mailHdr;
-    char        *buffer = new char [MAX_PACKET_SIZE];
-
     for (;;) {
-        // First, wait for a message.
+        // First, wait for a message.  The interrupt handler already took it
+        // off the network, into a mail of its own.
         messageAvailable->P();
-        pktHdr = network->Receive(buffer);
+        Mail *mail;
+        bool taken = received.Pop(&mail);
+        ASSERT(taken);
 
-        mailHdr = *(MailHeader *) buffer;
         if (debug.IsEnabled('n')) {
             printf("Putting mail into mailbox: ");
-            PrintHeader(pktHdr, mailHdr);
+            PrintHeader(mail->pktHdr, mail->mailHdr);
         }
 
         // Check that arriving message is legal!
-        ASSERT(0 <= mailHdr.to && mailHdr.to < numBoxes);
-        ASSERT(mailHdr.length <= MAX_MAIL_SIZE);
-
-        // Put into mailbox.
-        boxes[mailHdr.to].Put(pktHdr, mailHdr, buffer + sizeof (MailHeader));
+        ASSERT(0 <= mail->mailHdr.to && mail->mailHdr.to < numBoxes);
+        ASSERT(mail->mailHdr.length <= MAX_MAIL_SIZE);
+
+        // Put into mailbox, as it is.
+        boxes[mail->mailHdr.to].Put(mail);
+
+        if (receiveStalled) {
+            // Now there is room for the packet left in the network.
+            IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+            receiveStalled = false;
+            TakePacket();
+            interrupt->SetLevel(oldLevel);
+        }
     }
 }
 
@@ -248,34 +307,34 @@ void
 PostOffice::Send(PacketHeader pktHdr, MailHeader mailHdr, const char *data)
 {
     ASSERT(data != nullptr);
+    ASSERT(mailHdr.length <= MAX_MAIL_SIZE);
 
-    char *buffer = new char [MAX_PACKET_SIZE];  // Space to hold concatenated
-                                                // `mailHdr` + data.
+    Mail mail(pktHdr, mailHdr, data);  // Concatenate `MailHeader` and data.
+    SendMail(&mail);
+}
+
+/// The `MailHeader` and the data are already together in `mail`, so the
+/// network takes them from there.
+void
+PostOffice::SendMail(Mail *mail)
+{
+    ASSERT(mail != nullptr);
 
     if (debug.IsEnabled('n')) {
         printf("Post send: ");
-        PrintHeader(pktHdr, mailHdr);
+        PrintHeader(mail->pktHdr, mail->mailHdr);
     }
-    ASSERT(mailHdr.length <= MAX_MAIL_SIZE);
-    ASSERT(0 <= mailHdr.to && mailHdr.to < numBoxes);
+    ASSERT(mail->mailHdr.length <= MAX_MAIL_SIZE);
+    ASSERT(0 <= mail->mailHdr.to && mail->mailHdr.to < numBoxes);
 
     // Fill in `pktHdr`, for the `Network` layer.
-    pktHdr.from = netAddr;
-    pktHdr.length = mailHdr.length + sizeof (MailHeader);
-
-    // Concatenate `MailHeader` and data.
-    memmove(buffer, &mailHdr, sizeof (MailHeader));
-    memmove(buffer + sizeof (MailHeader), data, mailHdr.length);
-
-    sendLock->Acquire();  // Only one message can be sent to the network at
-                          // any one time.
-    network->Send(pktHdr, buffer);
-    messageSent->P();  // Wait for interrupt to tell us ok to send the next
-                       // message.
-    sendLock->Release();
-
-    delete [] buffer;  // We have sent the message, so we can delete our
-                       // buffer.
+    mail->pktHdr.from   = netAddr;
+    mail->pktHdr.length = mail->mailHdr.length + sizeof (MailHeader);
+
+    transmitSlots->P();  // Wait for room in the network.
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    network->Send(mail->pktHdr, (const char *) &mail->mailHdr);
+    interrupt->SetLevel(oldLevel);
 }
 
 /// Retrieve a message from a specific box if one is available, otherwise
@@ -301,15 +360,60 @@ PostOffice::Receive(int box, PacketHeader *pktHdr,
     ASSERT(mailHdr->length <= MAX_MAIL_SIZE);
 }
 
+Mail *
+PostOffice::ReceiveMail(int box)
+{
+    ASSERT(box >= 0 && box < numBoxes);
+
+    return boxes[box].GetMail();
+}
+
+Mail *
+PostOffice::ReceiveMail(int box, unsigned long timeout)
+{
+    ASSERT(box >= 0 && box < numBoxes);
+
+    return boxes[box].GetMail(timeout);
+}
+
 /// Interrupt handler, called when a packet arrives from the network.
 ///
-/// Signal the PostalDelivery routine that it is time to get to work!
+/// Take the packet off the network right away, so that it can receive the
+/// next one, and signal the PostalDelivery routine that it is time to get
+/// to work!
 void
 PostOffice::IncomingPacket()
 {
+    TakePacket();
+}
+
+/// Runs in the interrupt handler, or with interrupts disabled, so it is the
+/// only producer of `received`.
+void
+PostOffice::TakePacket()
+{
+    if (received.IsFull()) {
+        receiveStalled = true;  // Stays in the network until there is room.
+        return;
+    }
+    Mail *mail = new Mail;
+    mail->pktHdr = network->Receive((char *) &mail->mailHdr);
+    received.Push(mail);
     messageAvailable->V();
 }
 
+NetworkAddress
+PostOffice::GetAddress() const
+{
+    return netAddr;
+}
+
+int
+PostOffice::GetNumBoxes() const
+{
+    return numBoxes;
+}
+
 /// Interrupt handler, called when the next packet can be put onto the
 /// network.
 ///
@@ -318,5 +422,5 @@ PostOffice::IncomingPacket()
 void
 PostOffice::PacketSent()
 {
-    messageSent->V();
+    transmitSlots->V();
 }
@@ -28,6 +28,7 @@
 
 
 #include "network.hh"
+#include "lib/spsc_ring.hh"
 #include "threads/semaphore.hh"
 #include "threads/synch_list.hh"
 
@@ -60,15 +61,33 @@ const unsigned MAX_MAIL_SIZE = MAX_PACKET_SIZE - sizeof (MailHeader);
 /// 1. network header (`PacketHeader`);
 /// 2. post office header (`MailHeader`);
 /// 3. data.
+///
+/// The post office header and the data are together, just as the network
+/// carries them, so that packets go to and from the `Network` without
+/// copying them anywhere else.
 class Mail {
 public:
 
+    /// Initialize an empty mail message, to be filled in place.
+    Mail();
+
     /// Initialize a mail message by concatenating the headers to the data.
     Mail(PacketHeader pktH, MailHeader mailH, const char *msgData);
 
     PacketHeader pktHdr;               ///< Header appended by `Network`.
     MailHeader   mailHdr;              ///< Header appended by `PostOffice`.
     char         data[MAX_MAIL_SIZE];  ///< Payload -- message data.
+
+    /// Mails are taken from and given back to a pool, so that once it has
+    /// grown to the most mails ever in use, no packet goes to the global
+    /// heap.  Interrupt handlers take mails too.
+    static void *operator new(size_t size);
+    static void operator delete(void *p);
+
+private:
+
+    /// Unused mails, chained through their first bytes.
+    static Mail *freeMails;
 };
 
 /// The following class defines a single mailbox, or temporary storage
@@ -86,20 +105,35 @@ public:
     /// De-allocate mail box.
     ~MailBox();
 
-    /// Atomically put a message into the mailbox.
-    void Put(PacketHeader pktHdr, MailHeader mailHdr, const char *data);
+    /// Atomically put a message into the mailbox.  The mailbox keeps
+    /// `mail` itself.
+    void Put(Mail *mail);
 
     /// Atomically get a message out of the mailbox (and wait if there is no
     /// message to get!).
     void Get(PacketHeader *pktHdr, MailHeader *mailHdr, char *data);
 
+    /// The same, but hand out the message itself instead of copying it.
+    /// The caller deletes it when done.
+    Mail *GetMail();
+
+    /// The same, but wait no more than `timeout` ticks (not at all, if 0);
+    /// null if no message came.
+    Mail *GetMail(unsigned long timeout);
+
 private:
 
     /// A mailbox is just a list of arrived messages.
     SynchList<Mail *> *messages;
 
+    /// How many messages are in `messages`, for waiting with a timeout.
+    Semaphore *available;
+
 };
 
+/// How many received packets can wait for the postal worker.
+const unsigned RECEIVED_RING_SIZE = 16;
+
 /// The following class defines a “post office”, or a collection of
 /// mailboxes.
 ///
@@ -110,6 +144,9 @@ private:
 ///
 /// Incoming messages are put by the `PostOffice` into the appropriate
 /// mailbox, waking up any threads waiting on `Receive`.
+///
+/// Up to `NETWORK_QUEUE_SIZE` messages can be on their way out at a time;
+/// `Send` only waits when there are more.
 class PostOffice {
 public:
 
@@ -127,12 +164,24 @@ public:
     /// The `fromBox` in the `MailHeader` is the return box for ack's.
     void Send(PacketHeader pktHdr, MailHeader mailHdr, const char *data);
 
+    /// The same, for a message already put together in `mail`: nothing is
+    /// copied but into the network.  The caller keeps `mail`.
+    void SendMail(Mail *mail);
+
     // Retrieve a message from `box`.
     //
     // Wait if there is no message in the box.
     void Receive(int box, PacketHeader *pktHdr,
                  MailHeader *mailHdr, char *data);
 
+    /// The same, but hand out the message itself instead of copying it.
+    /// The caller deletes it when done.
+    Mail *ReceiveMail(int box);
+
+    /// The same, but wait no more than `timeout` ticks (not at all, if 0);
+    /// null if no message came.
+    Mail *ReceiveMail(int box, unsigned long timeout);
+
     // Wait for incoming messages, and then put them in the correct mailbox.
     void PostalDelivery();
 
@@ -144,6 +193,12 @@ public:
     /// pulled off of network (i.e., time to call `PostalDelivery`).
     void IncomingPacket();
 
+    /// Network address of this machine.
+    NetworkAddress GetAddress() const;
+
+    /// How many mail boxes there are, numbered from 0.
+    int GetNumBoxes() const;
+
 private:
 
     /// Physical network connection.
@@ -161,11 +216,20 @@ private:
     // `V`'ed when message has arrived from network.
     Semaphore *messageAvailable;
 
-    // `V`'ed when next message can be sent to network.
-    Semaphore *messageSent;
+    /// Packets taken off the network as soon as they arrive, so that the
+    /// network can go on receiving while the postal worker catches up.
+    /// Filled by `IncomingPacket`, emptied by `PostalDelivery`.
+    SpscRing<Mail *, RECEIVED_RING_SIZE> received;
+
+    /// The ring was full, so a packet was left in the network.
+    bool receiveStalled;
+
+    /// Move the packet the network just got into `received`.
+    void TakePacket();
 
-    // Only one outgoing message at a time.
-    Lock *sendLock;
+    /// Room for outgoing messages in the network; `V`'ed every time one
+    /// is done.
+    Semaphore *transmitSlots;
 
 };
 
@@ -0,0 +1,517 @@
+/// Copyright (c) 2016-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "shared_memory.hh"
+#include "message_port.hh"
+#include "machine/system_dep.hh"
+#include "threads/system.hh"
+
+#include <string.h>
+
+
+/// Dummy function because C++ cannot indirectly invoke member functions.
+static void
+ServeHelper(void *arg)
+{
+    ASSERT(arg != nullptr);
+    ((SharedMemory *) arg)->Serve();
+}
+
+SharedHeader::SharedHeader(SharedMessageType type_, unsigned page_)
+{
+    type    = type_;
+    access  = SHARED_NONE;
+    page    = page_;
+    machine = 0;
+    offset  = 0;
+}
+
+/// Every page starts out all zeroes, owned by its home.
+SharedMemory::SharedMemory(unsigned machines_)
+{
+    ASSERT(machines_ > 0 && machines_ <= MAX_SHARED_MACHINES);
+    ASSERT((unsigned) postOffice->GetAddress() < machines_);
+    machines = machines_;
+
+    lock      = new Lock("shared memory");
+    faultLock = new Lock("shared memory fault");
+    for (unsigned page = 0; page < SHARED_MEMORY_PAGES; page++) {
+        bool home = HomeOf(page) == postOffice->GetAddress();
+        copies[page].access = home ? SHARED_WRITE : SHARED_NONE;
+        copies[page].frame  = -1;
+        homes[page].owner       = HomeOf(page);
+        homes[page].readers     = 0;
+        homes[page].current     = nullptr;
+        homes[page].hasCopy     = false;
+        homes[page].pendingAcks = 0;
+    }
+
+    // Bind the mail boxes, only so that user programs cannot take them.
+    MessagePort::Bind(SHARED_MEMORY_BOX, nullptr);
+    MessagePort::Bind(SHARED_MEMORY_REPLY_BOX, nullptr);
+
+    Thread *t = new Thread("shared memory server");
+    t->Fork(ServeHelper, this);
+
+    // Mail sent to a machine that has not started yet is lost.
+    if (machines > 1) {
+        SystemDep::Delay(2);  // Time to start the other machines.
+    }
+}
+
+unsigned
+SharedMemory::GetMachines() const
+{
+    return machines;
+}
+
+NetworkAddress
+SharedMemory::HomeOf(unsigned page) const
+{
+    return page % machines;
+}
+
+void
+SharedMemory::Attach(AddressSpace *space)
+{
+    ASSERT(space != nullptr);
+
+    lock->Acquire();
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    ASSERT(spaces.Add(space) != -1);
+    interrupt->SetLevel(oldLevel);
+    for (unsigned page = 0; page < SHARED_MEMORY_PAGES; page++) {
+        if (copies[page].frame != -1) {
+            Map(page);
+        }
+    }
+    lock->Release();
+}
+
+void
+SharedMemory::Detach(AddressSpace *space)
+{
+    for (unsigned i = 0; i < Table<AddressSpace *>::SIZE; i++) {
+        if (spaces.HasKey(i) && spaces.Get(i) == space) {
+            spaces.Remove(i);
+        }
+    }
+}
+
+/// Pages this machine already has are only mapped.  Otherwise the home is
+/// asked for the page, which comes either whole or, if this machine already
+/// has a good copy, as a grant to write on it.
+void
+SharedMemory::Fault(unsigned page, bool writing)
+{
+    ASSERT(page < SHARED_MEMORY_PAGES);
+
+    faultLock->Acquire();
+    lock->Acquire();
+    Copy *copy = &copies[page];
+    if (copy->access == SHARED_WRITE
+          || (copy->access == SHARED_READ && !writing)) {
+        Map(page);
+        lock->Release();
+        faultLock->Release();
+        return;
+    }
+    lock->Release();
+
+    DEBUG('n', "Asking machine %d for shared page %u, to %s\n",
+          HomeOf(page), page, writing ? "write" : "read");
+    stats->numSharedFaults++;
+    SharedHeader request(writing ? SHARED_WRITE_REQUEST
+                                 : SHARED_READ_REQUEST, page);
+    Post(HomeOf(page), SHARED_MEMORY_BOX, &request);
+
+    // Only one page is asked for at a time, and it comes from a single
+    // machine, so its pieces arrive one after the other.
+    SharedAccess access;
+    unsigned received = 0;
+    for (;;) {
+        Mail *mail = postOffice->ReceiveMail(SHARED_MEMORY_REPLY_BOX);
+        const SharedHeader *header = (const SharedHeader *) mail->data;
+        if (!IsWellFormed(mail) || header->page != page
+              || (header->type != SHARED_GRANT
+                  && header->type != SHARED_PAGE)
+              || header->access == SHARED_NONE) {
+            DEBUG('n', "Bad shared memory mail from machine %d, dropped\n",
+                  mail->pktHdr.from);
+            delete mail;
+            continue;
+        }
+        access = (SharedAccess) header->access;
+        if (header->type == SHARED_GRANT) {
+            delete mail;
+            break;
+        }
+        unsigned length = mail->mailHdr.length - sizeof *header;
+        memcpy(incoming + header->offset, mail->data + sizeof *header, length);
+        received += length;
+        delete mail;
+        if (received == PAGE_SIZE) {
+            break;
+        }
+    }
+
+    lock->Acquire();
+    if (received > 0) {
+        if (copy->frame == -1) {
+            copy->frame = paginaMapa->Find();
+            ASSERT(copy->frame != -1);
+        }
+        memcpy(&machine->GetMMU()->mainMemory[copy->frame * PAGE_SIZE],
+               incoming, PAGE_SIZE);
+        stats->numSharedPagesRecvd++;
+    }
+    copy->access = access;
+    Map(page);
+    lock->Release();
+
+    SharedHeader confirm(SHARED_CONFIRM, page);
+    Post(HomeOf(page), SHARED_MEMORY_BOX, &confirm);
+    faultLock->Release();
+}
+
+int
+SharedMemory::Load(unsigned address)
+{
+    ASSERT(address % 4 == 0 && address < SHARED_MEMORY_SIZE);
+
+    unsigned page = address / PAGE_SIZE;
+    for (;;) {
+        lock->Acquire();
+        const Copy *copy = &copies[page];
+        if (copy->access != SHARED_NONE && copy->frame != -1) {
+            int value;
+            memcpy(&value, &machine->GetMMU()->mainMemory[
+                       copy->frame * PAGE_SIZE + address % PAGE_SIZE],
+                   sizeof value);
+            lock->Release();
+            return value;
+        }
+        lock->Release();
+        Fault(page, false);
+    }
+}
+
+void
+SharedMemory::Store(unsigned address, int value)
+{
+    ASSERT(address % 4 == 0 && address < SHARED_MEMORY_SIZE);
+
+    unsigned page = address / PAGE_SIZE;
+    for (;;) {
+        lock->Acquire();
+        const Copy *copy = &copies[page];
+        if (copy->access == SHARED_WRITE && copy->frame != -1) {
+            memcpy(&machine->GetMMU()->mainMemory[
+                       copy->frame * PAGE_SIZE + address % PAGE_SIZE],
+                   &value, sizeof value);
+            lock->Release();
+            return;
+        }
+        lock->Release();
+        Fault(page, true);
+    }
+}
+
+void
+SharedMemory::Serve()
+{
+    for (;;) {
+        Mail *mail = postOffice->ReceiveMail(SHARED_MEMORY_BOX);
+        if (!IsWellFormed(mail)) {
+            DEBUG('n', "Bad shared memory mail from machine %d, dropped\n",
+                  mail->pktHdr.from);
+            delete mail;
+            continue;
+        }
+        const SharedHeader *header = (const SharedHeader *) mail->data;
+        unsigned page = header->page;
+
+        lock->Acquire();
+        if (!IsExpected(mail)) {
+            DEBUG('n', "Unexpected shared memory mail from machine %d"
+                  " about page %u, dropped\n", mail->pktHdr.from, page);
+            lock->Release();
+            delete mail;
+            continue;
+        }
+        switch (header->type) {
+            case SHARED_READ_REQUEST:
+            case SHARED_WRITE_REQUEST: {
+                Request *request = new Request;
+                request->machine = mail->pktHdr.from;
+                request->writing = header->type == SHARED_WRITE_REQUEST;
+                Enqueue(page, request);
+                break;
+            }
+
+            case SHARED_FORWARD: {
+                SharedAccess access = (SharedAccess) header->access;
+                SendPage(page, header->machine, access);
+                if (access == SHARED_WRITE) {
+                    Drop(page);
+                } else {
+                    copies[page].access = SHARED_READ;
+                    if (copies[page].frame != -1) {
+                        Map(page);
+                    }
+                }
+                break;
+            }
+
+            case SHARED_INVALIDATE: {
+                Drop(page);
+                SharedHeader ack(SHARED_INVALIDATED, page);
+                Post(mail->pktHdr.from, SHARED_MEMORY_BOX, &ack);
+                break;
+            }
+
+            case SHARED_INVALIDATED:
+                if (--homes[page].pendingAcks == 0) {
+                    Grant(page);
+                }
+                break;
+
+            case SHARED_CONFIRM:
+                Finish(page);
+                break;
+
+            default:
+                ASSERT(false);
+        }
+        lock->Release();
+        delete mail;
+    }
+}
+
+/// Anyone may send mail to the shared memory boxes, user programs too, so
+/// nothing in it is taken for granted.
+bool
+SharedMemory::IsWellFormed(const Mail *mail) const
+{
+    ASSERT(mail != nullptr);
+
+    const SharedHeader *header = (const SharedHeader *) mail->data;
+    if (mail->mailHdr.length < sizeof *header
+          || mail->pktHdr.from < 0
+          || (unsigned) mail->pktHdr.from >= machines
+          || header->type > SHARED_CONFIRM
+          || header->access > SHARED_WRITE
+          || header->page >= SHARED_MEMORY_PAGES) {
+        return false;
+    }
+    if (header->type == SHARED_FORWARD && header->machine >= machines) {
+        return false;
+    }
+    if (header->type == SHARED_PAGE) {
+        unsigned length = mail->mailHdr.length - sizeof *header;
+        return header->offset + length <= PAGE_SIZE;
+    }
+    return true;
+}
+
+bool
+SharedMemory::IsExpected(const Mail *mail) const
+{
+    const SharedHeader *header = (const SharedHeader *) mail->data;
+    unsigned page = header->page;
+    bool home = HomeOf(page) == postOffice->GetAddress();
+    switch (header->type) {
+        case SHARED_READ_REQUEST:
+        case SHARED_WRITE_REQUEST:
+            return home;
+        case SHARED_FORWARD:
+            return copies[page].access != SHARED_NONE
+                   && header->access != SHARED_NONE;
+        case SHARED_INVALIDATE:
+            return true;
+        case SHARED_INVALIDATED:
+            return home && homes[page].pendingAcks > 0;
+        case SHARED_CONFIRM:
+            return home && homes[page].current != nullptr
+                   && homes[page].current->machine == mail->pktHdr.from;
+        default:
+            return false;
+    }
+}
+
+void
+SharedMemory::Post(NetworkAddress to, MailBoxAddress box,
+                   SharedHeader *header, const char *data, unsigned length)
+{
+    ASSERT(header != nullptr);
+    ASSERT(data != nullptr || length == 0);
+    ASSERT(length <= SHARED_CHUNK_SIZE);
+
+    Mail mail;
+    memcpy(mail.data, header, sizeof *header);
+    if (length > 0) {
+        memcpy(mail.data + sizeof *header, data, length);
+    }
+    mail.pktHdr.to      = to;
+    mail.mailHdr.to     = box;
+    mail.mailHdr.from   = SHARED_MEMORY_BOX;
+    mail.mailHdr.length = sizeof *header + length;
+    postOffice->SendMail(&mail);
+}
+
+void
+SharedMemory::SendPage(unsigned page, NetworkAddress to, SharedAccess access)
+{
+    DEBUG('n', "Sending shared page %u to machine %d\n", page, to);
+
+    char zeroes[SHARED_CHUNK_SIZE];
+    memset(zeroes, 0, sizeof zeroes);
+    const char *data = nullptr;
+    if (copies[page].frame != -1) {
+        data = &machine->GetMMU()->mainMemory[copies[page].frame * PAGE_SIZE];
+    }
+
+    SharedHeader header(SHARED_PAGE, page);
+    header.access = access;
+    for (unsigned offset = 0; offset < PAGE_SIZE;
+         offset += SHARED_CHUNK_SIZE) {
+        unsigned length = PAGE_SIZE - offset < SHARED_CHUNK_SIZE
+                          ? PAGE_SIZE - offset : SHARED_CHUNK_SIZE;
+        header.offset = offset;
+        Post(to, SHARED_MEMORY_REPLY_BOX, &header,
+             data != nullptr ? data + offset : zeroes, length);
+    }
+}
+
+/// The page tables change with interrupts off, because address spaces are
+/// detached with interrupts off.
+void
+SharedMemory::Map(unsigned page)
+{
+    Copy *copy = &copies[page];
+    if (copy->access != SHARED_NONE && copy->frame == -1) {
+        copy->frame = paginaMapa->Find();
+        ASSERT(copy->frame != -1);
+        memset(&machine->GetMMU()->mainMemory[copy->frame * PAGE_SIZE], 0,
+               PAGE_SIZE);
+    }
+
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    for (unsigned i = 0; i < Table<AddressSpace *>::SIZE; i++) {
+        if (!spaces.HasKey(i)) {
+            continue;
+        }
+        TranslationEntry *entry = spaces.Get(i)->GetSharedEntry(page);
+        entry->valid        = copy->access != SHARED_NONE;
+        entry->readOnly     = copy->access == SHARED_READ;
+        entry->physicalPage = copy->frame;
+    }
+    interrupt->SetLevel(oldLevel);
+}
+
+void
+SharedMemory::Drop(unsigned page)
+{
+    DEBUG('n', "Dropping shared page %u\n", page);
+
+    Copy *copy = &copies[page];
+    copy->access = SHARED_NONE;
+    Map(page);
+    if (copy->frame != -1) {
+        paginaMapa->Clear(copy->frame);
+        copy->frame = -1;
+    }
+    stats->numSharedInvalidations++;
+}
+
+void
+SharedMemory::Enqueue(unsigned page, Request *request)
+{
+    ASSERT(HomeOf(page) == postOffice->GetAddress());
+    ASSERT(request->machine >= 0 && (unsigned) request->machine < machines);
+
+    if (homes[page].current != nullptr) {
+        homes[page].waiting.Append(request);
+    } else {
+        Start(page, request);
+    }
+}
+
+/// A reader gets the page from the owner, which keeps a copy.  A writer
+/// waits until every other copy is invalidated; the owner's too, unless it
+/// is the one that sends the page.
+void
+SharedMemory::Start(unsigned page, Request *request)
+{
+    Home *home = &homes[page];
+    home->current = request;
+
+    if (!request->writing) {
+        SharedHeader forward(SHARED_FORWARD, page);
+        forward.access  = SHARED_READ;
+        forward.machine = request->machine;
+        Post(home->owner, SHARED_MEMORY_BOX, &forward);
+        return;
+    }
+
+    unsigned bit = 1u << request->machine;
+    home->hasCopy = home->owner == request->machine
+                    || (home->readers & bit) != 0;
+    unsigned others = home->readers & ~bit;
+    if (home->hasCopy && home->owner != request->machine) {
+        others |= 1u << home->owner;
+    }
+
+    home->pendingAcks = 0;
+    for (unsigned m = 0; m < machines; m++) {
+        if (others & 1u << m) {
+            SharedHeader invalidate(SHARED_INVALIDATE, page);
+            Post(m, SHARED_MEMORY_BOX, &invalidate);
+            home->pendingAcks++;
+        }
+    }
+    if (home->pendingAcks == 0) {
+        Grant(page);
+    }
+}
+
+void
+SharedMemory::Grant(unsigned page)
+{
+    Home *home = &homes[page];
+    ASSERT(home->current != nullptr && home->current->writing);
+
+    if (home->hasCopy) {
+        SharedHeader grant(SHARED_GRANT, page);
+        grant.access = SHARED_WRITE;
+        Post(home->current->machine, SHARED_MEMORY_REPLY_BOX, &grant);
+    } else {
+        SharedHeader forward(SHARED_FORWARD, page);
+        forward.access  = SHARED_WRITE;
+        forward.machine = home->current->machine;
+        Post(home->owner, SHARED_MEMORY_BOX, &forward);
+    }
+}
+
+void
+SharedMemory::Finish(unsigned page)
+{
+    Home *home = &homes[page];
+    Request *request = home->current;
+    ASSERT(request != nullptr);
+
+    if (request->writing) {
+        home->owner   = request->machine;
+        home->readers = 0;
+    } else {
+        home->readers |= 1u << request->machine;
+    }
+    delete request;
+    home->current = nullptr;
+
+    if (!home->waiting.IsEmpty()) {
+        Start(page, home->waiting.Pop());
+    }
+}
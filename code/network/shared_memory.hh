@@ -0,0 +1,208 @@
+/// Distributed shared memory: a region of user address spaces that several
+/// Nachos machines see alike.
+///
+/// With `-dsm <machines>`, every address space gets `SHARED_MEMORY_SIZE`
+/// more bytes between the program and the stack (see `SharedRegion` in
+/// `userprog/syscall.h`).  Machines `0` to `machines - 1` keep copies of
+/// the pages of that region, and page `p` has a home, machine
+/// `p % machines`, which keeps track of them.
+///
+/// Any number of machines may have a copy of a page to read, or a single one
+/// a copy to write (single writer, multiple readers).  The page table maps
+/// copies that may only be read as read-only, so a machine that touches a
+/// page it has no copy of, or writes to one it can only read, takes a fault
+/// and asks the home of the page for it.  The home serves one request for a
+/// page at a time: for a write, it first has every other copy invalidated;
+/// then the owner (the machine that wrote the page last) sends the page
+/// over, unless the writer already has it.
+///
+/// Mails are never retransmitted, so the network must not lose packets
+/// (the default reliability, `-n 1`; `-dsm` is refused with less).  Mail
+/// that is malformed, or that does not fit the state of its page, is
+/// dropped.  A machine serves the pages it is the
+/// home or the owner of only while it runs: it keeps waiting for requests
+/// after its programs finish, until it is killed or a program halts it.
+///
+/// Copyright (c) 2016-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_NETWORK_SHAREDMEMORY__HH
+#define NACHOS_NETWORK_SHAREDMEMORY__HH
+
+
+#include "post.hh"
+#include "lib/list.hh"
+#include "lib/table.hh"
+#include "machine/mmu.hh"
+#include "threads/lock.hh"
+#include "userprog/syscall.h"
+
+
+class AddressSpace;
+
+/// Pages in the shared region.
+const unsigned SHARED_MEMORY_PAGES = SHARED_MEMORY_SIZE / PAGE_SIZE;
+static_assert(SHARED_MEMORY_SIZE % PAGE_SIZE == 0,
+              "the shared region is made of whole pages");
+
+/// Machines that may share the region, at most.  The home of a page keeps
+/// a bit for each of them.
+const unsigned MAX_SHARED_MACHINES = 32;
+
+/// Mail boxes where every machine takes requests about pages, and the
+/// answers to its own requests.
+const MailBoxAddress SHARED_MEMORY_BOX       = 8;
+const MailBoxAddress SHARED_MEMORY_REPLY_BOX = 9;
+
+/// What a machine may do with its copy of a page.
+enum SharedAccess {
+    SHARED_NONE,
+    SHARED_READ,
+    SHARED_WRITE
+};
+
+/// Mail about a page.
+enum SharedMessageType {
+    SHARED_READ_REQUEST,   ///< To the home: the sender wants to read.
+    SHARED_WRITE_REQUEST,  ///< To the home: the sender wants to write.
+    SHARED_FORWARD,        ///< To the owner: send the page to `machine`.
+    SHARED_INVALIDATE,     ///< To a machine with a copy: drop it.
+    SHARED_INVALIDATED,    ///< To the home: the copy was dropped.
+    SHARED_GRANT,          ///< To the requester: its copy is good.
+    SHARED_PAGE,           ///< To the requester: a piece of the page.
+    SHARED_CONFIRM         ///< To the home: the requester has the page.
+};
+
+/// The following class defines the header `SharedMemory` prepends to the
+/// data of each mail.
+class SharedHeader {
+public:
+
+    /// Initialize a header of the given type about `page`; the rest is
+    /// filled in as needed.
+    SharedHeader(SharedMessageType type, unsigned page);
+
+    unsigned char  type;     ///< A `SharedMessageType`.
+    unsigned char  access;   ///< Forward, grant and page: what the
+                             ///< requester may do with its copy.
+    unsigned short page;
+    unsigned short machine;  ///< Forward: where the page goes.
+    unsigned short offset;   ///< Page: where the data goes in the page.
+};
+
+/// Data of a page carried by a single mail.
+const unsigned SHARED_CHUNK_SIZE = MAX_MAIL_SIZE - sizeof (SharedHeader);
+
+/// The following class defines this machine's part of the shared memory.
+///
+/// Address spaces attach to it when they are created; whenever this machine
+/// gets or loses a copy of a page, their page tables follow.  A thread
+/// serves the mail of other machines until the machine halts; so the
+/// shared memory is never deleted.
+class SharedMemory {
+public:
+
+    /// Share the region among machines `0` to `machines - 1`; this one must
+    /// be one of them.
+    SharedMemory(unsigned machines);
+
+    /// How many machines share the region.
+    unsigned GetMachines() const;
+
+    /// Map the pages this machine has in `space`, and keep them mapped.
+    void Attach(AddressSpace *space);
+
+    /// Stop mapping pages in `space`.  Called when it is deleted, with
+    /// interrupts off.
+    void Detach(AddressSpace *space);
+
+    /// Wait until this machine may read `page`, or write it if `writing`,
+    /// and map it in every attached address space.
+    void Fault(unsigned page, bool writing);
+
+    /// Read or write the word at byte `address` of the region, for kernel
+    /// code (user programs go through their page tables).
+    int Load(unsigned address);
+    void Store(unsigned address, int value);
+
+    /// Serve the mail of other machines.  Never returns.
+    void Serve();
+
+private:
+
+    /// This machine's copy of a page.
+    struct Copy {
+        SharedAccess access;
+        int frame;  ///< -1 while the page is all zeroes.
+    };
+
+    /// A machine waiting for a page.
+    struct Request {
+        NetworkAddress machine;
+        bool writing;
+    };
+
+    /// What the home of a page knows about it.
+    struct Home {
+        NetworkAddress owner;
+        unsigned readers;       ///< Bit `m` set if machine `m`, other than
+                                ///< the owner, has a copy.
+        Request *current;       ///< Being served; null if none.
+        bool hasCopy;           ///< Whether `current` has a good copy.
+        unsigned pendingAcks;   ///< Invalidations not answered yet.
+        List<Request *> waiting;
+    };
+
+    /// Machine that is the home of `page`.
+    NetworkAddress HomeOf(unsigned page) const;
+
+    /// Whether `mail` is about a page of the region, from one of the
+    /// machines sharing it, with fields that make sense for its type.
+    bool IsWellFormed(const Mail *mail) const;
+
+    /// Whether the well formed `mail`, which arrived at
+    /// `SHARED_MEMORY_BOX`, fits what this machine knows of its page.  With
+    /// `lock` held.
+    bool IsExpected(const Mail *mail) const;
+
+    /// Send a mail with `header` and `length` bytes of `data` to mail box
+    /// `box` of machine `to`.
+    void Post(NetworkAddress to, MailBoxAddress box, SharedHeader *header,
+              const char *data = nullptr, unsigned length = 0);
+
+    /// Send this machine's copy of `page` to `to`, which may then do
+    /// `access` with it.
+    void SendPage(unsigned page, NetworkAddress to, SharedAccess access);
+
+    /// Give `page` a frame if it has none, and update the page tables of
+    /// the attached address spaces.  With `lock` held.
+    void Map(unsigned page);
+
+    /// Drop this machine's copy of `page`.  With `lock` held.
+    void Drop(unsigned page);
+
+    /// Home side, with `lock` held: take `request` for `page`, start
+    /// serving it, let the requester have the page, and finish with it.
+    void Enqueue(unsigned page, Request *request);
+    void Start(unsigned page, Request *request);
+    void Grant(unsigned page);
+    void Finish(unsigned page);
+
+    unsigned machines;
+
+    /// Protects the copies, the homes and the attached address spaces.
+    Lock *lock;
+
+    Copy copies[SHARED_MEMORY_PAGES];
+    Home homes[SHARED_MEMORY_PAGES];  ///< Used for the pages this machine
+                                      ///< is the home of.
+    Table<AddressSpace *> spaces;
+
+    /// This machine waits for one page at a time, which arrives here.
+    Lock *faultLock;
+    char incoming[PAGE_SIZE];
+};
+
+
+#endif
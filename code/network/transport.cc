@@ -0,0 +1,356 @@
+/// Copyright (c) 2016-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "transport.hh"
+#include "threads/system.hh"
+
+#include <string.h>
+
+
+/// DeliverHelper, RetransmitHelper, TimeoutHandler
+///
+/// Dummy functions because C++ cannot indirectly invoke member functions.
+///
+/// * `arg` is a pointer to the connection.
+
+static void
+DeliverHelper(void *arg)
+{
+    ASSERT(arg != nullptr);
+    ((Connection *) arg)->Deliver();
+}
+
+static void
+RetransmitHelper(void *arg)
+{
+    ASSERT(arg != nullptr);
+    ((Connection *) arg)->Retransmit();
+}
+
+static void
+TimeoutHandler(void *arg)
+{
+    ASSERT(arg != nullptr);
+    ((Connection *) arg)->TimeoutExpired();
+}
+
+Connection::Connection(MailBoxAddress localBox_,
+                       NetworkAddress farAddr_, MailBoxAddress farBox_)
+{
+    localBox = localBox_;
+    farAddr  = farAddr_;
+    farBox   = farBox_;
+
+    lock             = new Lock("connection");
+    base             = 0;
+    nextSeq          = 0;
+    duplicateAcks    = 0;
+    roundTrip        = 0;
+    roundTripDev     = 0;
+    timeout          = RETRANSMIT_TIMEOUT;
+    windowOpen       = new Condition("window open", lock);
+    allAcked         = new Condition("all acknowledged", lock);
+    retransmitNeeded = new Semaphore("retransmit needed", 0);
+    timerPending     = false;
+
+    expected           = 0;
+    assembling         = nullptr;
+    assembledLength    = 0;
+    assemblingCapacity = 0;
+    messageReady       = new Condition("message ready", lock);
+
+    memset(sendWindow, 0, sizeof sendWindow);
+    memset(recvWindow, 0, sizeof recvWindow);
+
+    Thread *t = new Thread("transport delivery");
+    t->Fork(DeliverHelper, this);
+    t = new Thread("transport retransmission");
+    t->Fork(RetransmitHelper, this);
+}
+
+void
+Connection::Send(const char *data, unsigned size)
+{
+    ASSERT(data != nullptr || size == 0);
+
+    lock->Acquire();
+    unsigned offset = 0;
+    do {
+        while (nextSeq - base == TRANSPORT_WINDOW) {
+            windowOpen->Wait();
+        }
+        Fragment *f = &sendWindow[nextSeq % TRANSPORT_WINDOW];
+        f->length        = size - offset < MAX_FRAGMENT_SIZE
+                           ? size - offset : MAX_FRAGMENT_SIZE;
+        f->last          = offset + f->length == size;
+        f->present       = false;
+        f->resend        = false;
+        f->retransmitted = false;
+        memcpy(f->data, data + offset, f->length);
+        offset += f->length;
+        SendFragment(nextSeq++);
+        StartTimer();
+    } while (offset < size);
+    lock->Release();
+}
+
+unsigned
+Connection::Receive(char *data, unsigned size)
+{
+    ASSERT(data != nullptr || size == 0);
+
+    lock->Acquire();
+    while (messages.IsEmpty()) {
+        messageReady->Wait();
+    }
+    Message *message = messages.Pop();
+    lock->Release();
+
+    unsigned length = message->length < size ? message->length : size;
+    memcpy(data, message->data, length);
+    delete [] message->data;
+    delete message;
+    return length;
+}
+
+void
+Connection::Flush()
+{
+    lock->Acquire();
+    while (base != nextSeq) {
+        allAcked->Wait();
+    }
+    lock->Release();
+}
+
+void
+Connection::SendFragment(unsigned seq)
+{
+    Fragment *f = &sendWindow[seq % TRANSPORT_WINDOW];
+    Mail mail;
+    TransportHeader *header = (TransportHeader *) mail.data;
+    header->seq   = seq;
+    header->type  = TRANSPORT_DATA;
+    header->flags = f->last ? TRANSPORT_LAST : 0;
+    memcpy(mail.data + sizeof *header, f->data, f->length);
+
+    mail.pktHdr.to      = farAddr;
+    mail.mailHdr.to     = farBox;
+    mail.mailHdr.from   = localBox;
+    mail.mailHdr.length = sizeof *header + f->length;
+    DEBUG('n', "Sending fragment %u, %u bytes\n", seq, f->length);
+    postOffice->SendMail(&mail);
+    f->sentAt = stats->totalTicks;
+}
+
+void
+Connection::SendAck()
+{
+    Mail mail;
+    TransportHeader *header = (TransportHeader *) mail.data;
+    header->seq   = expected;
+    header->type  = TRANSPORT_ACK;
+    header->flags = 0;
+    for (unsigned i = 1; i < TRANSPORT_WINDOW; i++) {
+        if (recvWindow[(expected + i) % TRANSPORT_WINDOW].present) {
+            header->flags |= 1 << (i - 1);
+        }
+    }
+
+    mail.pktHdr.to      = farAddr;
+    mail.mailHdr.to     = farBox;
+    mail.mailHdr.from   = localBox;
+    mail.mailHdr.length = sizeof *header;
+    postOffice->SendMail(&mail);
+}
+
+/// Only numbers from `base` to `nextSeq` can be acknowledged; anything else
+/// is an old acknowledgement that arrived late.
+void
+Connection::HandleAck(const TransportHeader *header)
+{
+    unsigned ack = header->seq;
+    if (ack - base > nextSeq - base) {
+        return;
+    }
+
+    if (ack != base) {
+        // A fragment sent more than once does not tell which time it was
+        // acknowledged.
+        const Fragment *newest = &sendWindow[(ack - 1) % TRANSPORT_WINDOW];
+        if (!newest->retransmitted) {
+            MeasureRoundTrip(stats->totalTicks - newest->sentAt);
+        }
+        base          = ack;
+        duplicateAcks = 0;
+        windowOpen->Broadcast();
+        if (base == nextSeq) {
+            allAcked->Broadcast();
+        }
+    } else if (base != nextSeq && ++duplicateAcks == DUPLICATE_ACKS) {
+        DEBUG('n', "Fragment %u skipped, retransmitting\n", base);
+        sendWindow[base % TRANSPORT_WINDOW].resend = true;
+        retransmitNeeded->V();
+    }
+
+    for (unsigned i = 0; i < TRANSPORT_WINDOW - 1; i++) {
+        unsigned seq = ack + 1 + i;
+        if ((header->flags & 1 << i) && seq - base < nextSeq - base) {
+            sendWindow[seq % TRANSPORT_WINDOW].present = true;
+        }
+    }
+}
+
+/// Fragments beyond the window are dropped, and the sender will try them
+/// again; fragments already delivered are just acknowledged again, in case
+/// the first acknowledgement was lost.
+void
+Connection::HandleData(const TransportHeader *header,
+                       const char *data, unsigned length)
+{
+    unsigned seq = header->seq;
+    if (seq - expected < TRANSPORT_WINDOW) {
+        Fragment *f = &recvWindow[seq % TRANSPORT_WINDOW];
+        if (!f->present) {
+            f->length  = length;
+            f->last    = header->flags & TRANSPORT_LAST;
+            f->present = true;
+            memcpy(f->data, data, length);
+        }
+    }
+
+    // Put together what is now in order.
+    for (;;) {
+        Fragment *f = &recvWindow[expected % TRANSPORT_WINDOW];
+        if (!f->present) {
+            break;
+        }
+        if (assembledLength + f->length > assemblingCapacity) {
+            assemblingCapacity = 2 * assemblingCapacity + MAX_FRAGMENT_SIZE;
+            char *bigger = new char [assemblingCapacity];
+            memcpy(bigger, assembling, assembledLength);
+            delete [] assembling;
+            assembling = bigger;
+        }
+        memcpy(assembling + assembledLength, f->data, f->length);
+        assembledLength += f->length;
+        if (f->last) {
+            Message *message = new Message;
+            message->data   = assembling;
+            message->length = assembledLength;
+            messages.Append(message);
+            messageReady->Signal();
+            assembling         = nullptr;
+            assembledLength    = 0;
+            assemblingCapacity = 0;
+        }
+        f->present = false;
+        expected++;
+    }
+
+    SendAck();
+}
+
+void
+Connection::Deliver()
+{
+    for (;;) {
+        Mail *mail = postOffice->ReceiveMail(localBox);
+        if (mail->pktHdr.from != farAddr || mail->mailHdr.from != farBox
+              || mail->mailHdr.length < sizeof (TransportHeader)) {
+            DEBUG('n', "Mail in box %d not for the connection, dropped\n",
+                  localBox);
+            delete mail;
+            continue;
+        }
+
+        const TransportHeader *header = (const TransportHeader *) mail->data;
+        lock->Acquire();
+        if (header->type == TRANSPORT_ACK) {
+            HandleAck(header);
+        } else {
+            HandleData(header, mail->data + sizeof *header,
+                       mail->mailHdr.length - sizeof *header);
+        }
+        lock->Release();
+        delete mail;
+    }
+}
+
+/// Fragments the peer already has are left alone.  When the timeout goes by
+/// without an acknowledgement, the network is probably losing many packets
+/// or is slower than measured, so wait twice as much for the next ones.
+void
+Connection::Retransmit()
+{
+    for (;;) {
+        retransmitNeeded->P();
+
+        lock->Acquire();
+        bool expired = false;
+        for (unsigned seq = base; seq != nextSeq; seq++) {
+            Fragment *f = &sendWindow[seq % TRANSPORT_WINDOW];
+            if (f->present) {
+                continue;
+            }
+            bool late = stats->totalTicks - f->sentAt >= timeout;
+            if (f->resend || late) {
+                DEBUG('n', "Retransmitting fragment %u\n", seq);
+                f->resend        = false;
+                f->retransmitted = true;
+                SendFragment(seq);
+                stats->numRetransmissions++;
+                expired = expired || late;
+            }
+        }
+        if (expired) {
+            timeout = 2 * timeout < MAX_RETRANSMIT_TIMEOUT
+                      ? 2 * timeout : MAX_RETRANSMIT_TIMEOUT;
+        }
+        if (base != nextSeq) {
+            StartTimer();
+        }
+        lock->Release();
+    }
+}
+
+/// Jacobson's estimator, in fixed point: the mean gets 1/8 of the way to
+/// each sample, and the deviation 1/4.
+void
+Connection::MeasureRoundTrip(unsigned long sample)
+{
+    if (roundTrip == 0) {
+        roundTrip    = 8 * sample;
+        roundTripDev = 2 * sample;
+    } else {
+        long error = (long) sample - (long) (roundTrip / 8);
+        roundTrip    += error;
+        roundTripDev += (error < 0 ? -error : error) - roundTripDev / 4;
+    }
+    timeout = roundTrip / 8 + roundTripDev;
+    if (timeout < MIN_RETRANSMIT_TIMEOUT) {
+        timeout = MIN_RETRANSMIT_TIMEOUT;
+    } else if (timeout > MAX_RETRANSMIT_TIMEOUT) {
+        timeout = MAX_RETRANSMIT_TIMEOUT;
+    }
+}
+
+void
+Connection::TimeoutExpired()
+{
+    timerPending = false;
+    retransmitNeeded->V();
+}
+
+void
+Connection::StartTimer()
+{
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    if (!timerPending) {
+        timerPending = true;
+        interrupt->Schedule(TimeoutHandler, this, timeout, TRANSPORT_INT);
+    }
+    interrupt->SetLevel(oldLevel);
+}
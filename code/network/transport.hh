@@ -0,0 +1,174 @@
+/// Reliable, ordered delivery of messages of any size between two mailboxes,
+/// on top of the unreliable `PostOffice`.
+///
+/// A message is cut into fragments that fit in a mail, each one numbered in
+/// sequence.  Up to `TRANSPORT_WINDOW` fragments may be on their way at a
+/// time without waiting for their acknowledgement (a sliding window).  The
+/// receiver keeps fragments that arrive ahead of a lost one, and answers
+/// each fragment with the number of the next one it expects (a cumulative
+/// acknowledgement) plus which of the following ones it already has.
+///
+/// The sender retransmits a fragment when it is not acknowledged within a
+/// timeout, or as soon as three acknowledgements in a row show that it was
+/// skipped.  The timeout is scheduled on the interrupt queue; it follows
+/// the round trip times measured on fragments sent only once (the mean
+/// plus four times the mean deviation, as TCP does), and doubles every
+/// time it expires.
+///
+/// Copyright (c) 2016-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_NETWORK_TRANSPORT__HH
+#define NACHOS_NETWORK_TRANSPORT__HH
+
+
+#include "post.hh"
+#include "lib/list.hh"
+#include "threads/condition.hh"
+
+
+/// The following class defines the header a `Connection` prepends to the
+/// data of each mail.
+class TransportHeader {
+public:
+    unsigned       seq;    ///< Data: number of the fragment.  Ack: number
+                           ///< of the next fragment expected.
+    unsigned short type;   ///< `TRANSPORT_DATA` or `TRANSPORT_ACK`.
+    unsigned short flags;  ///< Data: `TRANSPORT_LAST` if it ends a message.
+                           ///< Ack: bit `i` set if fragment `seq + 1 + i`
+                           ///< already arrived.
+};
+
+const unsigned short TRANSPORT_DATA = 0;
+const unsigned short TRANSPORT_ACK  = 1;
+const unsigned short TRANSPORT_LAST = 1;
+
+/// Data carried by a single fragment.
+const unsigned MAX_FRAGMENT_SIZE = MAX_MAIL_SIZE - sizeof (TransportHeader);
+
+/// Fragments sent and not acknowledged yet, at most.  The acknowledgement
+/// has a bit for each of them.
+const unsigned TRANSPORT_WINDOW = 8;
+static_assert(TRANSPORT_WINDOW <= 16, "acknowledgements have 16 bits");
+
+/// Ticks to wait for an acknowledgement before retransmitting: before the
+/// first round trip is measured, and the least and most ever.
+const unsigned long RETRANSMIT_TIMEOUT     = 8000;
+const unsigned long MIN_RETRANSMIT_TIMEOUT = 1000;
+const unsigned long MAX_RETRANSMIT_TIMEOUT = 16000;
+
+/// Acknowledgements that repeat the same number before the fragment with
+/// it is retransmitted.
+const unsigned DUPLICATE_ACKS = 3;
+
+/// The following class defines one end of a reliable connection.
+///
+/// It owns the local mailbox `localBox`, and talks to the connection at
+/// mailbox `farBox` of machine `farAddr` (which may be this same machine).
+/// Two threads serve it until the machine halts: one takes the mail that
+/// arrives, and the other retransmits; so a connection is never deleted.
+class Connection {
+public:
+
+    Connection(MailBoxAddress localBox,
+               NetworkAddress farAddr, MailBoxAddress farBox);
+
+    /// Send `size` bytes of `data` as a single message.
+    ///
+    /// Returns once every fragment was sent at least once; it waits while
+    /// the window is full.
+    void Send(const char *data, unsigned size);
+
+    /// Wait for the next message and copy up to `size` bytes of it into
+    /// `data`; the rest of it is dropped.  Returns how many bytes were
+    /// copied.
+    unsigned Receive(char *data, unsigned size);
+
+    /// Wait until everything sent was acknowledged.
+    void Flush();
+
+    /// Take the mail that arrives in `localBox`.  Never returns.
+    void Deliver();
+
+    /// Retransmit the fragments whose time ran out.  Never returns.
+    void Retransmit();
+
+    /// Interrupt handler, called when the retransmission timeout expires.
+    void TimeoutExpired();
+
+private:
+
+    /// A fragment in the send or receive window.
+    struct Fragment {
+        unsigned      length;
+        bool          last;
+        bool          present;        ///< Receive: it arrived.  Send: the
+                                      ///< peer said it arrived.
+        bool          resend;         ///< Send: acknowledgements skip it.
+        bool          retransmitted;  ///< Send: it went out more than once.
+        unsigned long sentAt;         ///< Send: ticks when it last went out.
+        char          data[MAX_FRAGMENT_SIZE];
+    };
+
+    /// A message put together and waiting for `Receive`.
+    struct Message {
+        char    *data;
+        unsigned length;
+    };
+
+    /// Send fragment `seq` of the send window.  With `lock` held.
+    void SendFragment(unsigned seq);
+
+    /// Acknowledge what arrived so far.  With `lock` held.
+    void SendAck();
+
+    /// Handle an acknowledgement from the peer.  With `lock` held.
+    void HandleAck(const TransportHeader *header);
+
+    /// Handle a fragment from the peer.  With `lock` held.
+    void HandleData(const TransportHeader *header,
+                    const char *data, unsigned length);
+
+    /// Schedule the retransmission timeout, unless it is already pending.
+    void StartTimer();
+
+    /// Take `sample` ticks of round trip into account for the timeout.
+    void MeasureRoundTrip(unsigned long sample);
+
+    MailBoxAddress localBox;
+    NetworkAddress farAddr;
+    MailBoxAddress farBox;
+
+    /// Protects everything below.
+    Lock *lock;
+
+    /// Sending side: fragments `base` to `nextSeq - 1` are not acknowledged
+    /// yet; fragment `n` is at `sendWindow[n % TRANSPORT_WINDOW]`.
+    Fragment sendWindow[TRANSPORT_WINDOW];
+    unsigned base;
+    unsigned nextSeq;
+    unsigned duplicateAcks;
+    unsigned long roundTrip;     ///< Smoothed, times 8; 0 if unknown.
+    unsigned long roundTripDev;  ///< Smoothed mean deviation, times 4.
+    unsigned long timeout;
+    Condition *windowOpen;
+    Condition *allAcked;
+
+    /// Set by the interrupt handler; the retransmitter waits for it.
+    Semaphore *retransmitNeeded;
+    bool timerPending;
+
+    /// Receiving side: fragment `expected` is the next one that goes into
+    /// the message being put together, from `recvWindow`.
+    Fragment recvWindow[TRANSPORT_WINDOW];
+    unsigned expected;
+    char *assembling;
+    unsigned assembledLength;
+    unsigned assemblingCapacity;
+    List<Message *> messages;
+    Condition *messageReady;
+};
+
+
+#endif
@@ -0,0 +1,47 @@
+/// Copyright (c) 2016-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "benchmark.hh"
+#include "system.hh"
+
+#include <stdio.h>
+
+
+Benchmark::Benchmark(const char *name_)
+{
+    ASSERT(name_ != nullptr);
+
+    name       = name_;
+    startTicks = stats->totalTicks;
+    startTime  = SystemDep::HostTime();
+}
+
+double
+Benchmark::GetElapsed() const
+{
+    return (SystemDep::HostTime() - startTime) * 1e9;
+}
+
+unsigned long
+Benchmark::GetTicks() const
+{
+    return stats->totalTicks - startTicks;
+}
+
+/// Printed as, for example:
+///
+///     Ping-pong: 1087.9 ns and 40.0 ticks per round trip, 200000 in 217.6 ms
+void
+Benchmark::Report(unsigned long count, const char *unit) const
+{
+    ASSERT(unit != nullptr);
+
+    double elapsed = GetElapsed();
+    unsigned long ticks = GetTicks();
+    printf("%s: %.1f ns and %.1f ticks per %s, %lu in %.1f ms\n", name,
+           count > 0 ? elapsed / count : 0.0,
+           count > 0 ? (double) ticks / count : 0.0,
+           unit, count, elapsed / 1e6);
+}
@@ -0,0 +1,42 @@
+/// Measuring benchmarks.
+///
+/// A `Benchmark` notes the host time and the simulated ticks when it is
+/// created, and reports how much of each went into every operation of the
+/// code that ran since.  The thread tests that measure performance and the
+/// console benchmark all report through it, so their results read alike.
+///
+/// Copyright (c) 2016-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_THREADS_BENCHMARK__HH
+#define NACHOS_THREADS_BENCHMARK__HH
+
+
+class Benchmark {
+public:
+
+    /// Start measuring.  `name` goes at the front of the report.
+    Benchmark(const char *name);
+
+    /// Host nanoseconds since the start.
+    double GetElapsed() const;
+
+    /// Simulated ticks since the start.
+    unsigned long GetTicks() const;
+
+    /// Print the host time and ticks that each of `count` operations took,
+    /// naming the operation `unit`.
+    void Report(unsigned long count, const char *unit) const;
+
+private:
+
+    const char *name;
+
+    /// Host time (in seconds) and ticks at the start.
+    double startTime;
+    unsigned long startTicks;
+};
+
+
+#endif
@@ -8,23 +8,33 @@
 #include "channel.hh"
 #include "condition.hh"
 #include "lock.hh"
+#include "semaphore.hh"
 #include "system.hh"
 #include <cstdio>
-Channel::Channel(const char *debugName)
+Channel::Channel(const char *debugName, unsigned capacity_)
 {
     name = debugName;
     Acceso = new Lock("Access Channel Lock");
     BloqueanteSend = new Condition(debugName, Acceso);
     BloqueanteReceive = new Condition(debugName, Acceso);
-    buzon = new List <int>;
+
+    capacity = capacity_;
+    slots = capacity > 0 ? capacity : 1;  // Un rendezvous guarda un solo mensaje.
+    buzon = new int [slots];
+    first = count = 0;
+    sent = received = 0;
+    receiversWaiting = 0;
+    selectors = new List <Semaphore *>;
 }
 
 Channel::~Channel()
 {
+    ASSERT(selectors->IsEmpty());
     delete BloqueanteSend;
-    delete BloqueanteReceive;
+    delete BloqueanteReceive;
     delete Acceso;
-    delete buzon;
+    delete [] buzon;
+    delete selectors;
 }
 
 const char *
@@ -33,46 +43,204 @@ Channel::GetName() const
     return name;
 }
 
+unsigned
+Channel::GetCapacity() const
+{
+    return capacity;
+}
+
+static void
+WakeSelector(Semaphore *selector)
+{
+    selector->V();
+}
+
+unsigned
+Channel::Put(const int *mensajes, unsigned n)
+{
+    unsigned puestos = 0;
+    while (puestos < n && count < slots) {
+        buzon[(first + count) % slots] = mensajes[puestos++];
+        count++;
+    }
+    sent += puestos;
+
+    if (puestos > 0) {
+        if (count > 1) {
+            BloqueanteReceive->Broadcast();
+        } else {
+            BloqueanteReceive->Signal();
+        }
+        selectors->Apply(WakeSelector);
+    }
+    return puestos;
+}
+
+unsigned
+Channel::Take(int *mensajes, unsigned n)
+{
+    unsigned tomados = 0;
+    while (tomados < n && count > 0) {
+        mensajes[tomados++] = buzon[first];
+        first = (first + 1) % slots;
+        count--;
+    }
+    received += tomados;
+
+    if (tomados > 0) {
+        // Despierto a todos: unos esperan lugar, otros (rendezvous) que
+        // llegue su mensaje, y cada uno sabe si le toca.
+        BloqueanteSend->Broadcast();
+    }
+    return tomados;
+}
+
+void
+Channel::WaitDelivered(unsigned long ticket)
+{
+    while (received < ticket) {
+        BloqueanteSend->Wait();
+    }
+}
+
 void
 Channel::Send(int mensaje)
 {
-    Acceso->Acquire(); //Solo 1 puede operar a la vez en el canal
-    buzon->Append(mensaje);
-
-
-    BloqueanteReceive->Signal();
-    int b = 0;
-     if(buzon->Head()) {
-       b = buzon->Head();
-    }
-
-    while(! buzon->IsEmpty() && b == buzon->Head())
-        BloqueanteSend->Wait();
-
-  //  if(BloqueanteReceive->SleepingThreadAmount() != 0){//Si hay un proceso que puso un Receive y esta esperando dormido le mando un Signal y me duermo a la espera que este me levante para completar la operacion
-  //      BloqueanteReceive->Signal();
-  //      BloqueanteSend->Wait();
- //   } else {
-//	    BloqueanteSend->Wait();//Si no hay procesos esperando un Send, entonces me tengo que ir a dormir y esperar mi Receive
-//    }
-    Acceso->Release(); //Si llego aqui es porque me levante de la siesta o habia un nodo que esperaba mi Send, de ambas formas suelto el Lock de Acceso
+    SendN(&mensaje, 1);
 }
 
 void
 Channel::Receive(int* mensaje)
 {
-    Acceso->Acquire(); //Solo 1 puede operar a la vez en el canal
-
-    while(buzon->IsEmpty())
-        BloqueanteReceive->Wait();
-
- //   if(BloqueanteSend->SleepingThreadAmount() != 0) {//Si hay un proceso esperando mi receive le mando mi signal
-//	    BloqueanteSend->Signal();
-//    } else {//Si no hay un Proceso esperando mi Receive entonces me voy a dormir hasta que uno haga signal y suelto el lock del receptor
-//	    BloqueanteReceive->Wait();
-//    }
-    *mensaje = buzon->Pop(); //Aca si puedo capturar el mensaje ya que me garantizo que hay por lo menos uno en el buzon
-    BloqueanteSend->Signal();
+    ASSERT(mensaje != nullptr);
+    ReceiveN(mensaje, 1);
+}
+
+void
+Channel::SendN(const int *mensajes, unsigned n)
+{
+    ASSERT(mensajes != nullptr);
+
+    Acceso->Acquire(); //Solo 1 puede operar a la vez en el canal
+    unsigned enviados = 0;
+    while (enviados < n) {
+        while (count == slots) {
+            BloqueanteSend->Wait();  // Buzon lleno, espero lugar.
+        }
+        enviados += Put(mensajes + enviados, n - enviados);
+    }
+    if (capacity == 0) {
+        WaitDelivered(sent);  // Rendezvous: espero que reciban el ultimo.
+    }
+    Acceso->Release();
+}
+
+unsigned
+Channel::ReceiveN(int *mensajes, unsigned n)
+{
+    ASSERT(mensajes != nullptr);
+    ASSERT(n > 0);
+
+    Acceso->Acquire(); //Solo 1 puede operar a la vez en el canal
+    while (count == 0) {
+        receiversWaiting++;
+        BloqueanteReceive->Wait();
+        receiversWaiting--;
+    }
+    unsigned recibidos = Take(mensajes, n);
+    Acceso->Release();
+    return recibidos;
+}
+
+bool
+Channel::TrySend(int mensaje)
+{
+    Acceso->Acquire();
+    bool puedo = count < slots;
+    if (capacity == 0) {
+        // Sin buffer solo se puede si alguien ya esta bloqueado en
+        // `Receive`; el mensaje queda para el.  Un `Select` registrado no
+        // cuenta: puede elegir otro canal y el mensaje quedaria sin dueno.
+        puedo = puedo && receiversWaiting > 0;
+    }
+    if (puedo) {
+        Put(&mensaje, 1);
+    }
+    Acceso->Release();
+    return puedo;
+}
+
+bool
+Channel::TryReceive(int* mensaje)
+{
+    ASSERT(mensaje != nullptr);
+
+    Acceso->Acquire();
+    bool recibi = Take(mensaje, 1) == 1;
+    Acceso->Release();
+    return recibi;
+}
+
+void
+Channel::Register(Semaphore *selector)
+{
+    Acceso->Acquire();
+    selectors->Append(selector);
+    Acceso->Release();
+}
+
+void
+Channel::Unregister(Semaphore *selector)
+{
+    Acceso->Acquire();
+    selectors->Remove(selector);
     Acceso->Release();
 }
 
+/// Poll the channels; if none has a message, register a semaphore on all
+/// of them and sleep on it.  A channel that gets a message wakes up every
+/// registered selector, so after waking up we poll again.  The channels are
+/// polled starting at a different one each time, so that a busy channel
+/// does not starve the others.
+unsigned
+Channel::Select(Channel **channels, unsigned n, int *mensaje)
+{
+    ASSERT(channels != nullptr);
+    ASSERT(n > 0);
+    ASSERT(mensaje != nullptr);
+
+    static unsigned start = 0;
+    start++;
+
+    Semaphore *selector = nullptr;
+    unsigned elegido = n;
+    while (elegido == n) {
+        for (unsigned k = 0; k < n && elegido == n; k++) {
+            unsigned i = (start + k) % n;
+            if (channels[i]->TryReceive(mensaje)) {
+                elegido = i;
+            }
+        }
+        if (elegido != n) {
+            break;
+        }
+        if (selector == nullptr) {
+            // Me registro y vuelvo a mirar: un mensaje que llego mientras
+            // tanto no me despertaria.
+            selector = new Semaphore("Select", 0);
+            for (unsigned i = 0; i < n; i++) {
+                channels[i]->Register(selector);
+            }
+        } else {
+            selector->P();
+        }
+    }
+
+    if (selector != nullptr) {
+        for (unsigned i = 0; i < n; i++) {
+            channels[i]->Unregister(selector);
+        }
+        delete selector;
+    }
+    return elegido;
+}
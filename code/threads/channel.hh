@@ -19,33 +19,106 @@
 
 /// This class defines a “interprocess channel”.
 ///
-/// These are the two operations on Channel:
+/// These are the operations on Channel:
 ///
 /// * `Send` -- send a message(int).
 /// * `Receive` -- receive a message(int*)
+/// * `TrySend`, `TryReceive` -- the same, but give up instead of blocking.
+/// * `SendN`, `ReceiveN` -- move several messages with a single acquisition
+///   of the channel lock.
+/// * `Select` -- receive from whichever of several channels has a message.
+///
+/// A channel created with capacity 0 (the default) is a rendezvous: `Send`
+/// only returns once its message has been received.  `Thread::Join` and the
+/// file system `removeChannel` rely on that.  With a positive capacity the
+/// messages wait in a ring of that many slots and `Send` only blocks while
+/// the ring is full, so a producer can run ahead of its consumer.
 ///
 
 class Lock;
 class Condition;
+class Semaphore;
 
 class Channel {
 public:
 
-    Channel(const char *debugName);
+    Channel(const char *debugName, unsigned capacity = 0);
 
     ~Channel();
 
     const char *GetName() const;
 
-    /// The two operations on interprocess Channels.
+    unsigned GetCapacity() const;
+
+    /// The two basic operations on interprocess Channels.
     void Send(int mensaje);
     void Receive(int* mensaje);
+
+    /// Send without blocking.  Returns false, sending nothing, if the
+    /// channel is full -- or, for a rendezvous channel, if nobody is
+    /// blocked in `Receive`.  A thread in `Select` does not count, as it may
+    /// take its message from another channel.
+    bool TrySend(int mensaje);
+
+    /// Receive without blocking.  Returns false if there is no message.
+    bool TryReceive(int* mensaje);
+
+    /// Send all `n` messages, in order, blocking as needed.
+    void SendN(const int *mensajes, unsigned n);
+
+    /// Wait for at least one message and take up to `n`.
+    ///
+    /// Returns how many messages were received.
+    unsigned ReceiveN(int *mensajes, unsigned n);
+
+    /// Wait until one of the `n` `channels` has a message and receive it.
+    ///
+    /// Returns the index of the channel it came from.
+    static unsigned Select(Channel **channels, unsigned n, int *mensaje);
+
 private:
+
+    /// Copy as many of the `n` messages as fit into the ring and wake up
+    /// receivers.  `Acceso` must be held.  Returns how many were copied.
+    unsigned Put(const int *mensajes, unsigned n);
+
+    /// Take up to `n` messages out of the ring and wake up senders.
+    /// `Acceso` must be held.  Returns how many were taken.
+    unsigned Take(int *mensajes, unsigned n);
+
+    /// Rendezvous channels: sleep until message number `ticket` has been
+    /// received.  `Acceso` must be held.
+    void WaitDelivered(unsigned long ticket);
+
+    void Register(Semaphore *selector);
+    void Unregister(Semaphore *selector);
+
     const char *name;
     Lock* Acceso;
     Condition* BloqueanteSend;
     Condition* BloqueanteReceive;
-    List<int> *buzon;
+
+    /// Ring of `slots` messages; `count` of them are in use, starting at
+    /// `first`.
+    int *buzon;
+    unsigned slots;
+    unsigned first;
+    unsigned count;
+
+    /// Capacity asked for; 0 means rendezvous (and `slots` is 1).
+    unsigned capacity;
+
+    /// Messages ever put into and taken out of the ring.  A rendezvous
+    /// sender waits until `received` reaches the number of its message.
+    unsigned long sent;
+    unsigned long received;
+
+    /// Threads blocked in `Receive` or `ReceiveN`.
+    unsigned receiversWaiting;
+
+    /// Threads blocked in `Select` on this channel, each waiting on its
+    /// own semaphore.
+    List<Semaphore *> *selectors;
 };
 
 
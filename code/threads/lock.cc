@@ -9,6 +9,11 @@
 /// achieve this; another way could be leveraging an already existing
 /// primitive.
 ///
+/// Here the uncontended cases are a compare-and-swap on `state`, in the
+/// style of a futex; interrupts are only disabled when a thread has to
+/// wait or has to be woken up.  `state` holds the owner, so that no thread
+/// can ever see the lock held by nobody.
+///
 /// Copyright (c) 1992-1993 The Regents of the University of California.
 ///               2016-2021 Docentes de la Universidad Nacional de Rosario.
 /// All rights reserved.  See `copyright.h` for copyright notice and
@@ -16,21 +21,58 @@
 
 
 #include "lock.hh"
-#include "semaphore.hh"
 #include "system.hh"
-#include <cstdio>
-/// Dummy functions -- so we can compile our later assignments.
+
+#include <stdio.h>
+#include <string.h>
+
+
+/// Acquisition counters for all the locks sharing a name.
+struct LockProfile {
+    const char *name;
+    unsigned long acquires;
+    unsigned long contentions;
+    unsigned traceId;  ///< Identifies the name in traces.
+    LockProfile *next;
+};
+
+static LockProfile *profiles = nullptr;
+
+/// Find the counters for `name`, creating them the first time.
+static LockProfile *
+ProfileFor(const char *name)
+{
+    for (LockProfile *p = profiles; p != nullptr; p = p->next) {
+        if (strcmp(p->name, name) == 0) {
+            return p;
+        }
+    }
+    LockProfile *p = new LockProfile;
+    char *copy = new char [strlen(name) + 1];
+    strcpy(copy, name);
+    p->name        = copy;
+    p->acquires    = 0;
+    p->contentions = 0;
+    p->traceId     = tracer != nullptr ? tracer->NewLock(copy) : 0;
+    p->next        = profiles;
+    profiles       = p;
+    return p;
+}
 
 Lock::Lock(const char *debugName)
 {
+	static_assert(alignof (Thread) > CONTENDED,
+	              "No spare bit in a thread pointer to mark contention");
+
 	name = debugName;
-	semaphore = new Semaphore("Lock Semaphore", 1);
-	lockOwner = nullptr;
+	state = FREE;
+	boosted = false;
+	profile = ProfileFor(debugName == nullptr ? "(null)" : debugName);
 }
 
 Lock::~Lock()
 {
-	delete semaphore;
+	ASSERT(waiters.IsEmpty());
 }
 
 const char *
@@ -42,25 +84,132 @@ Lock::GetName() const
 void
 Lock::Acquire() //The lockOwner is a thread who calls mutex
 {
-	ASSERT(!IsHeldByCurrentThread()); //If another thread call mutex, this thread sleep zzz... with semaphore->P()
-	if(lockOwner != nullptr) {
-		lockOwner->SetInheritedPriority(this, currentThread->GetPriority());
+	ASSERT(!IsHeldByCurrentThread());
+
+	uintptr_t expected = FREE;
+	if (__atomic_compare_exchange_n(&state, &expected,
+	                                (uintptr_t) currentThread, false,
+	                                __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+		profile->acquires++;
+		return;
 	}
-	semaphore->P();
-	lockOwner = currentThread;
+	AcquireSlow();
+}
+
+/// The lock was busy: mark it contended, lend our priority to the owner
+/// and sleep until `Release` hands the lock over to us.
+void
+Lock::AcquireSlow()
+{
+	IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+	profile->acquires++;
+
+	// Somebody may have released the lock since we looked.  With
+	// interrupts off nobody else can touch `state` until we sleep.
+	uintptr_t observed = __atomic_load_n(&state, __ATOMIC_ACQUIRE);
+	if (observed == FREE) {
+		__atomic_store_n(&state, (uintptr_t) currentThread, __ATOMIC_RELAXED);
+		interrupt->SetLevel(oldLevel);
+		return;
+	}
+	__atomic_store_n(&state, observed | CONTENDED, __ATOMIC_RELAXED);
+
+	Thread *owner = Owner();
+	profile->contentions++;
+	stats->numLockContentions++;
+	unsigned long waitStart = stats->totalTicks;
+	DEBUG('s', "Thread \"%s\" waits for lock \"%s\" held by \"%s\"\n",
+	      currentThread->GetName(), name, owner->GetName());
+
+	unsigned int myPriority = currentThread->GetPriority();
+	if (myPriority > owner->GetPriority()) {
+		owner->SetInheritedPriority(this, myPriority);
+		boosted = true;
+	}
+
+	waiters.Append(currentThread);
+	currentThread->Sleep();
+
+	// `ReleaseSlow` made us the owner before waking us up.
+	ASSERT(Owner() == currentThread);
+	if (tracer != nullptr) {
+		tracer->RecordSince(TRACE_LOCK_WAIT, waitStart, profile->traceId);
+	}
+	interrupt->SetLevel(oldLevel);
 }
 
 void
 Lock::Release() //Only the treadKey can unlock de mutex
 {
     ASSERT(IsHeldByCurrentThread()); //Only the thread who call mutex can unlock them
-	lockOwner->RemoveInheritedPriority(this);
-	lockOwner = nullptr;
-	semaphore->V();
+
+	uintptr_t expected = (uintptr_t) currentThread;
+	if (__atomic_compare_exchange_n(&state, &expected, FREE, false,
+	                                __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+		return;
+	}
+	ReleaseSlow();
+}
+
+/// Somebody may be waiting: give the lock straight to the first waiter, so
+/// that nobody can take it in between, and give back borrowed priority.
+void
+Lock::ReleaseSlow()
+{
+	IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+
+	if (boosted) {
+		currentThread->RemoveInheritedPriority(this);
+		boosted = false;
+	}
+
+	Thread *next = waiters.Pop();
+	if (next == nullptr) {
+		__atomic_store_n(&state, FREE, __ATOMIC_RELEASE);
+	} else {
+		if (waiters.IsEmpty()) {
+			// Let the next `Release` take the fast path again.
+			__atomic_store_n(&state, (uintptr_t) next, __ATOMIC_RELEASE);
+		} else {
+			__atomic_store_n(&state, (uintptr_t) next | CONTENDED,
+			                 __ATOMIC_RELEASE);
+			// The new owner inherits from those still waiting.
+			unsigned int priority = next->GetPriority();
+			for (Thread *t = waiters.Head(); t != nullptr; t = t->waitLink.next) {
+				if (t->GetPriority() > priority) {
+					priority = t->GetPriority();
+				}
+			}
+			if (priority > next->GetPriority()) {
+				next->SetInheritedPriority(this, priority);
+				boosted = true;
+			}
+		}
+		scheduler->ReadyToRun(next);
+	}
+
+	interrupt->SetLevel(oldLevel);
+}
+
+Thread *
+Lock::Owner() const
+{
+	return (Thread *) (__atomic_load_n(&state, __ATOMIC_RELAXED) & ~CONTENDED);
 }
 
 bool
 Lock::IsHeldByCurrentThread() const
 {
-    return lockOwner == currentThread;
+    return Owner() == currentThread;
+}
+
+void
+Lock::PrintContention()
+{
+	for (LockProfile *p = profiles; p != nullptr; p = p->next) {
+		if (p->contentions != 0) {
+			printf("Lock \"%s\": acquired %lu, contended %lu\n",
+			       p->name, p->acquires, p->contentions);
+		}
+	}
 }
@@ -17,9 +17,10 @@
 #ifndef NACHOS_THREADS_LOCK__HH
 #define NACHOS_THREADS_LOCK__HH
 
-#include "semaphore.hh"
 #include "thread.hh"
-#include "lock.hh"
+#include "lib/intrusive_list.hh"
+
+#include <stdint.h>
 /// This class defines a “lock”.
 ///
 /// A lock can have two states: free and busy. Only two operations are
@@ -31,8 +32,17 @@
 ///
 /// For convenience, nobody but the thread that holds the lock can free it.
 /// There is no operation for reading the state of the lock.
-class Semaphore;
+///
+/// Most of the time a lock is free when it is acquired and nobody is
+/// waiting when it is released, so both operations first try to flip the
+/// state with a single atomic instruction, without disabling interrupts.
+/// The state is the owner itself, so taking the lock and becoming its
+/// owner are the same step.
+/// Only when that fails (somebody holds the lock, or somebody is waiting
+/// for it) do they take the slow path: disable interrupts, queue or wake a
+/// waiter, and lend priorities.
 class Thread;
+struct LockProfile;
 class Lock {
 public:
 
@@ -56,17 +66,39 @@ public:
     /// Useful for checks in `Release` and in condition variables.
     bool IsHeldByCurrentThread() const;
 
+    /// Print how many times the locks of each name were acquired and how
+    /// many of those had to wait, for the names that ever had to.
+    static void PrintContention();
+
 private:
 
+    /// Values of `state`, besides the owner.
+    enum : uintptr_t {
+        FREE      = 0,  ///< Nobody holds the lock.
+        CONTENDED = 1   ///< Or'ed with the owner: threads may be waiting.
+    };
+
+    void AcquireSlow();
+    void ReleaseSlow();
+
+    /// The thread that holds the lock, or null if it is free.
+    Thread *Owner() const;
+
     /// For debugging.
     const char *name;
 
-    // Add other needed fields here.
+    /// `FREE`, or the owner, possibly marked `CONTENDED`; changed
+    /// atomically.
+    uintptr_t state;
+
+    /// Threads waiting for the lock, in order of arrival.
+    IntrusiveList<Thread, &Thread::waitLink> waiters;
+
+    /// Did a waiter lend its priority to the owner?
+    bool boosted;
 
-   //Semaphore for a Lock implementation
-    Semaphore* semaphore;
-   //A thread who call de mutex, only it can  close de mutex
-    Thread* lockOwner;
+    /// Counters shared by every lock with the same name.
+    LockProfile *profile;
 };
 
 
@@ -10,13 +10,18 @@
 /// Usage
 /// =====
 ///
-///     nachos [-d <debugflags>] [-do <debugopts>] [-p]
+///     nachos [-d <debugflags>] [-do <debugopts>] [-p] [-ips]
+///            [-tr <trace file>]
 ///            [-rs <random seed #>] [-z] [-tt]
 ///            [-s] [-x <nachos file>] [-tc <consoleIn> <consoleOut>]
+///            [-tcb <consoleIn> <consoleOut>] [-cr] [-pf]
+///            [-pw <prefetch window>]
 ///            [-f] [-cp <unix file> <nachos file>] [-pr <nachos file>]
 ///            [-rm <nachos file>] [-ls] [-D] [-c] [-tf]
 ///            [-n <network reliability>] [-id <machine id>]
-///            [-tn <other machine id>]
+///            [-tn <other machine id>] [-tnr <other machine id>]
+///            [-tnm <other machine id>] [-tnp <other machine id>]
+///            [-dsm <# of machines>] [-tns]
 ///
 /// General options
 /// ---------------
@@ -28,6 +33,11 @@
 /// * `-p`  -- enables preemptive multitasking for kernel threads.
 /// * `-rs` -- causes `Yield` to occur at random (but repeatable) spots.
 /// * `-z`  -- prints version and copyright information, and exits.
+/// * `-ips` -- prints, along with the statistics, how many ticks and user
+///            instructions per second the host simulated.
+/// * `-tr` -- records context switches, page faults, disk requests, system
+///            calls and waits for locks, and saves the last ones to the
+///            given file at exit (see `machine/trace.hh`).
 ///
 /// *THREADS* options
 /// -----------------
@@ -41,6 +51,15 @@
 /// * `-s`  -- causes user programs to be executed in single-step mode.
 /// * `-x`  -- runs a user program.
 /// * `-tc` -- tests the console.
+/// * `-tcb` -- measures how fast a file goes through the synchronized
+///            console.
+/// * `-cr` -- console reads wait for the whole buffer to fill, instead of
+///            returning at the end of each line.
+/// * `-pf` -- profiles user programs by sampling them on every timer
+///            interrupt, and prints where each one spent its time when it
+///            ends (see `userprog/profiler.hh`).
+/// * `-pw` -- sets how many pages make up a fault-around window when
+///            loading pages on demand (1 disables prefetching).
 ///
 /// *FILESYS* options
 /// -----------------
@@ -60,6 +79,18 @@
 /// * `-n`  -- sets the network reliability.
 /// * `-id` -- sets this machine's host id (needed for the network).
 /// * `-tn` -- runs a simple test of the Nachos network software.
+/// * `-tnr` -- tests the reliable transport and reports its goodput; with
+///            this machine's own id, both ends run here.
+/// * `-tnm` -- measures how many mails per second the post office moves
+///            (with `-ips`); with this machine's own id, it talks to itself.
+/// * `-tnp` -- tests the message ports behind the network system calls;
+///            with this machine's own id, it talks to itself.
+/// * `-dsm` -- gives user programs a region of memory shared with the
+///            machines with ids from 0 to the given number minus one, which
+///            must all be started within two seconds (see
+///            `network/shared_memory.hh`).  Needs a network that does not
+///            lose packets (`-n 1`).
+/// * `-tns` -- tests the shared memory (with `-dsm`) on every machine.
 ///
 /// ----
 ///
@@ -93,7 +124,12 @@ void Print(const char *file);
 void PerformanceTest(void);
 void StartProcess(const char *file);
 void ConsoleTest(const char *in, const char *out);
+void ConsoleBenchmark(const char *in, const char *out);
 void MailTest(int networkID);
+void TransportTest(int networkID);
+void MailRateTest(int networkID);
+void PortTest(int networkID);
+void SharedMemoryTest();
 ///
 void TestSync(void);
 void TestDirectory();
@@ -162,6 +198,11 @@ main(int argc, char **argv)
             interrupt->Halt();  // Once we start the console, then Nachos
                                 // will loop forever waiting for console
                                 // input.
+        } else if (!strcmp(*argv, "-tcb")) {  // Console benchmark.
+            ASSERT(argc > 2);
+            ConsoleBenchmark(*(argv + 1), *(argv + 2));
+            argCount = 3;
+            interrupt->Halt();
         }
 #endif
 #ifdef FILESYS
@@ -202,6 +243,34 @@ main(int argc, char **argv)
                                   // time to start up another nachos.
             MailTest(atoi(*(argv + 1)));
             argCount = 2;
+        } else if (!strcmp(*argv, "-tnr")) {
+            ASSERT(argc > 1);
+            int farAddr = atoi(*(argv + 1));
+            if (farAddr != postOffice->GetAddress()) {
+                SystemDep::Delay(2);  // Give the user time to start up the
+                                      // other nachos, so that the clock
+                                      // does not run while waiting.
+            }
+            TransportTest(farAddr);
+            argCount = 2;
+        } else if (!strcmp(*argv, "-tnm")) {
+            ASSERT(argc > 1);
+            int farAddr = atoi(*(argv + 1));
+            if (farAddr != postOffice->GetAddress()) {
+                SystemDep::Delay(2);  // Time to start the other nachos.
+            }
+            MailRateTest(farAddr);
+            argCount = 2;
+        } else if (!strcmp(*argv, "-tnp")) {
+            ASSERT(argc > 1);
+            int farAddr = atoi(*(argv + 1));
+            if (farAddr != postOffice->GetAddress()) {
+                SystemDep::Delay(2);  // Time to start the other nachos.
+            }
+            PortTest(farAddr);
+            argCount = 2;
+        } else if (!strcmp(*argv, "-tns")) {
+            SharedMemoryTest();
         }
 #endif // NETWORK
     }
@@ -154,7 +154,7 @@ ContextSwitch(void)
     // Make a context switch if interrupts are enabled.
     if (interrupt->GetLevel() == INT_ON) {
         inContextSwitch = false;
-        currentThread->Yield();
+        currentThread->Preempt();
     } else {
         interrupt->YieldOnReturn();
         inContextSwitch = false;
@@ -9,8 +9,7 @@
 /// needed to wait for a lock, and the lock was busy, we would end up calling
 /// `FindNextToRun`, and that would put us in an infinite loop.
 ///
-/// Very simple implementation -- no priorities, straight FIFO.  Might need
-/// to be improved in later assignments.
+/// Multilevel feedback queue with priorities; see `scheduler.hh`.
 ///
 /// Copyright (c) 1992-1993 The Regents of the University of California.
 ///               2016-2021 Docentes de la Universidad Nacional de Rosario.
@@ -22,23 +21,45 @@
 #include "system.hh"
 
 #include <stdio.h>
-#include <climits>
 
 
 /// Initialize the list of ready but not running threads to empty.
 Scheduler::Scheduler()
 {
-	for (unsigned int i = 0; i < AMOUNT_OF_LISTS; ++i) {
-		readyList[i] = new List<Thread *>;
-	}
+    static_assert(NUM_READY_QUEUES <= sizeof readyMask * BITS_IN_BYTE,
+                  "Not enough bits in the ready bitmap");
+
+	readyMask = 0;
+	lastAging = 0;
+	chargedUserTicks = chargedSystemTicks = 0;
+#ifdef USER_PROGRAM
+	registerOwner = nullptr;
+#endif
 }
 
 /// De-allocate the list of ready threads.
 Scheduler::~Scheduler()
+{}
+
+unsigned
+Scheduler::QueueFor(const Thread *thread)
 {
-	for (unsigned int i = 0; i < AMOUNT_OF_LISTS; ++i) {
-		delete readyList[i];
+	unsigned band = thread->GetPriority();
+	if (band >= NUM_PRIORITY_BANDS) {
+		band = NUM_PRIORITY_BANDS - 1;
 	}
+	unsigned level = thread->GetPreAssignedQueue();
+	ASSERT(level < MLFQ_LEVELS);
+
+	/// Inside a band, level 0 gets the highest number.
+	return band * MLFQ_LEVELS + (MLFQ_LEVELS - 1 - level);
+}
+
+unsigned
+Scheduler::BestQueue() const
+{
+	ASSERT(readyMask != 0);
+	return sizeof readyMask * BITS_IN_BYTE - 1 - __builtin_clzll(readyMask);
 }
 
 /// Mark a thread as ready, but not running.
@@ -53,7 +74,9 @@ Scheduler::ReadyToRun(Thread *thread)
     DEBUG('t', "Putting thread %s on ready list\n", thread->GetName());
 
     thread->SetStatus(READY);
-    readyList[thread->GetPreAssignedQueue()]->SortedInsert(thread, INT_MAX - thread->GetPriority());
+    unsigned queue = QueueFor(thread);
+    readyList[queue].Append(thread);
+    readyMask |= (uint64_t) 1 << queue;
 }
 
 /// Return the next thread to be scheduled onto the CPU.
@@ -64,41 +87,49 @@ Scheduler::ReadyToRun(Thread *thread)
 Thread *
 Scheduler::FindNextToRun()
 {
-	unsigned int queue = 0;
-	int bestPriority = -1;
-	Thread* toExecute = nullptr;
-
-	/// If two threads have the same priority but are in different
-	/// queues it means that the one in queue 0 has executed for
-	/// a shorter time last time.
-	for (unsigned int i = 0; i < AMOUNT_OF_LISTS; ++i) {
-		if(readyList[i]->IsEmpty()) {
-			continue;
-		}
-
-		int priority;
-		Thread* thread = readyList[i]->SortedPop(&priority);
-		if(priority > bestPriority) {
-			if(bestPriority != -1) {
-				readyList[queue]->SortedInsert(toExecute, bestPriority);
-			}
-			bestPriority = priority;
-			toExecute = thread;
-			queue = i;
-		} else {
-			readyList[i]->SortedInsert(thread, priority);
-		}
+	if (stats->totalTicks - lastAging >= AGING_PERIOD) {
+		Age();
 	}
 
-	if(toExecute == nullptr) {
+	if (readyMask == 0) {
 		DEBUG('t', "Not found next to execute\n");
 		return nullptr;
 	}
 
+	unsigned queue = BestQueue();
+	Thread *toExecute = readyList[queue].Pop();
+	if (readyList[queue].IsEmpty()) {
+		readyMask &= ~((uint64_t) 1 << queue);
+	}
+
 	DEBUG('t', "Found next to execute \"%s\"\n", toExecute->GetName());
     return toExecute;
 }
 
+Thread *
+Scheduler::PeekNextToRun() const
+{
+	return readyMask == 0 ? nullptr : readyList[BestQueue()].Head();
+}
+
+void
+Scheduler::Age()
+{
+	lastAging = stats->totalTicks;
+	for (unsigned band = 0; band < NUM_PRIORITY_BANDS; band++) {
+		unsigned top = band * MLFQ_LEVELS + MLFQ_LEVELS - 1;
+		for (unsigned queue = band * MLFQ_LEVELS; queue < top; queue++) {
+			while (!readyList[queue].IsEmpty()) {
+				Thread *thread = readyList[queue].Pop();
+				thread->SetPreAssignedQueue(0);
+				readyList[top].Append(thread);
+				readyMask |= (uint64_t) 1 << top;
+			}
+			readyMask &= ~((uint64_t) 1 << queue);
+		}
+	}
+}
+
 /// Dispatch the CPU to `nextThread`.
 ///
 /// Save the state of the old thread, and load the state of the new thread,
@@ -117,14 +148,21 @@ Scheduler::Run(Thread *nextThread)
 
     Thread *oldThread = currentThread;
 
-#ifdef USER_PROGRAM  // Ignore until running user programs.
-    if (currentThread->space != nullptr) {
-        // If this thread is a user program, save the user's CPU registers.
-        currentThread->SaveUserState();
-        currentThread->space->SaveState();
+    if (nextThread == oldThread) {
+        // The thread was woken up (by an interrupt handler) while it was
+        // looking for someone to run; there is nothing to switch.
+        oldThread->SetStatus(RUNNING);
+        DEBUG('t', "Thread \"%s\" keeps running\n", oldThread->GetName());
+        return;
     }
+
+#ifdef USER_PROGRAM  // Ignore until running user programs.
+    SwitchUserContext(oldThread, nextThread);
 #endif
 
+    ChargeTime();
+    nextThread->usage.switches++;
+
     oldThread->CheckOverflow();  // Check if the old thread had an undetected
                                  // stack overflow.
 
@@ -133,6 +171,9 @@ Scheduler::Run(Thread *nextThread)
 
     DEBUG('t', "Switching from thread \"%s\" to thread \"%s\"\n",
           oldThread->GetName(), nextThread->GetName());
+    if (tracer != nullptr) {
+        tracer->Switch(nextThread->traceId);
+    }
 
     // This is a machine-dependent assembly language routine defined in
     // `switch.s`.  You may have to think a bit to figure out what happens
@@ -143,23 +184,84 @@ Scheduler::Run(Thread *nextThread)
 
     DEBUG('t', "Now in thread \"%s\"\n", currentThread->GetName());
 
-    // If the old thread gave up the processor because it was finishing, we
-    // need to delete its carcass.  Note we cannot delete the thread before
-    // now (for example, in `Thread::Finish`), because up to this point, we
-    // were still running on the old thread's stack!
+    DestroyFinished();
+}
+
+/// Threads are only charged when they leave the CPU (or when somebody
+/// asks), instead of on every tick.
+void
+Scheduler::ChargeTime()
+{
+    currentThread->usage.userTicks   += stats->userTicks - chargedUserTicks;
+    currentThread->usage.systemTicks += stats->systemTicks
+                                        - chargedSystemTicks;
+    chargedUserTicks   = stats->userTicks;
+    chargedSystemTicks = stats->systemTicks;
+}
+
+/// If the previous thread gave up the processor because it was finishing,
+/// delete its carcass.  Note we cannot delete the thread before now (for
+/// example, in `Thread::Finish`), because up to the switch we were still
+/// running on the old thread's stack!
+///
+/// Called right after `SWITCH`, both when it returns into `Run` and when
+/// it lands on a brand new thread, which starts in `ThreadRoot` instead.
+/// Otherwise a thread finishing into a new thread would never be deleted,
+/// nor would its stack go back to the pool.
+void
+Scheduler::DestroyFinished()
+{
     if (threadToBeDestroyed != nullptr) {
+#ifdef USER_PROGRAM
+        if (registerOwner == threadToBeDestroyed) {
+            registerOwner = nullptr;
+        }
+#endif
         delete threadToBeDestroyed;
         threadToBeDestroyed = nullptr;
     }
+}
 
 #ifdef USER_PROGRAM
-    if (currentThread->space != nullptr) {
-        // If there is an address space to restore, do it.
-        currentThread->RestoreUserState();
-        currentThread->space->RestoreState();
+/// Get the simulated machine ready to run `nextThread` instead of
+/// `oldThread`.
+///
+/// User registers are saved lazily: the machine keeps the registers of the
+/// last user thread that ran (`registerOwner`), and they are only copied out
+/// when a different user thread needs the machine.  Switching to a kernel
+/// thread and back costs nothing.
+///
+/// Threads that share an address space keep the MMU state as it is.
+///
+/// This is done before `SWITCH`, because a thread that runs for the first
+/// time does not come back through `Run`.
+void
+Scheduler::SwitchUserContext(Thread *oldThread, Thread *nextThread)
+{
+    if (oldThread->space != nullptr) {
+        // A running user thread owns the machine registers, even if it has
+        // just set them up itself (as when a process starts).
+        registerOwner = oldThread;
+        if (oldThread->space != nextThread->space) {
+            oldThread->space->SaveState();
+        }
+    }
+    if (nextThread->space == nullptr) {
+        return;
+    }
+
+    if (registerOwner != nextThread) {
+        if (registerOwner != nullptr) {
+            registerOwner->SaveUserState();
+        }
+        nextThread->RestoreUserState();
+        registerOwner = nextThread;
+    }
+    if (nextThread->space != oldThread->space) {
+        nextThread->space->RestoreState();
     }
-#endif
 }
+#endif
 
 /// Print the scheduler state -- in other words, the contents of the ready
 /// list.
@@ -175,9 +277,13 @@ ThreadPrint(Thread *t)
 void
 Scheduler::Print()
 {
-	for (unsigned int i = 0; i < AMOUNT_OF_LISTS; ++i) {
-		printf("Ready list %d contents:", i);
-		readyList[i]->Apply(ThreadPrint);
+	for (unsigned int i = NUM_READY_QUEUES; i-- > 0; ) {
+		if (readyList[i].IsEmpty()) {
+			continue;
+		}
+		printf("Ready list (band %u, level %u) contents:", i / MLFQ_LEVELS,
+		       MLFQ_LEVELS - 1 - i % MLFQ_LEVELS);
+		readyList[i].Apply(ThreadPrint);
 		printf("\n");
 	}
 }
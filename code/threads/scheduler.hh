@@ -12,14 +12,40 @@
 
 
 #include "thread.hh"
-#include "lib/list.hh"
+#include "lib/intrusive_list.hh"
 
-/// Top queue is 0
-static const unsigned int AMOUNT_OF_LISTS = 2;
+#include <stdint.h>
+
+
+/// Number of priority bands.  A thread goes into band
+/// `min(GetPriority(), NUM_PRIORITY_BANDS - 1)`, so every priority from the
+/// last band up is treated the same.
+static const unsigned NUM_PRIORITY_BANDS = 16;
+
+/// Number of feedback levels inside each band.  Top level is 0.
+static const unsigned MLFQ_LEVELS = 4;
+
+/// Total number of run queues; there must be one bit per queue in the
+/// ready bitmap.
+static const unsigned NUM_READY_QUEUES = NUM_PRIORITY_BANDS * MLFQ_LEVELS;
+
+/// Every `AGING_PERIOD` ticks all ready threads are moved back to the top
+/// level of their band, so that demoted threads do not starve.
+static const unsigned long AGING_PERIOD = 2000;
 
 /// The following class defines the scheduler/dispatcher abstraction --
 /// the data structures and operations needed to keep track of which
 /// thread is running, and which threads are ready but not running.
+///
+/// Ready threads are kept in a multilevel feedback queue: one FIFO queue
+/// per (priority band, level) pair, plus a bitmap telling which queues are
+/// non-empty.  Queues are numbered so that a higher number means a better
+/// candidate, hence picking the next thread is finding the highest set bit,
+/// and both `ReadyToRun` and `FindNextToRun` take constant time.
+///
+/// Threads are demoted one level each time their quantum expires, but not
+/// when they yield the CPU on their own, and go back to the top level when
+/// they block.  See `Thread::Preempt` and `Thread::Sleep`.
 class Scheduler {
 public:
 
@@ -35,18 +61,55 @@ public:
     /// Dequeue first thread on the ready list, if any, and return thread.
     Thread *FindNextToRun();
 
+    /// Return the thread `FindNextToRun` would pick, without dequeuing it.
+    Thread *PeekNextToRun() const;
+
     /// Cause `nextThread` to start running.
     void Run(Thread *nextThread);
 
+    /// Delete the thread that just finished, if any.
+    void DestroyFinished();
+
+    /// Add the ticks since the last call to the usage of the current
+    /// thread.
+    void ChargeTime();
+
     // Print contents of ready list.
     void Print();
 
 private:
 
-    // Queue of threads that are ready to run, but not running.
-    List<Thread*> *readyList[AMOUNT_OF_LISTS];
+    /// Index of the run queue for `thread`.
+    static unsigned QueueFor(const Thread *thread);
+
+    /// Index of the best non-empty run queue; `readyMask` must not be 0.
+    unsigned BestQueue() const;
+
+#ifdef USER_PROGRAM
+    /// Part of `Run` that deals with the simulated machine.
+    void SwitchUserContext(Thread *oldThread, Thread *nextThread);
+
+    /// Thread whose user registers are loaded in the machine, if any.
+    Thread *registerOwner;
+#endif
+
+    /// Move every ready thread to the top level of its band.
+    void Age();
+
+    typedef IntrusiveList<Thread, &Thread::readyLink> ReadyList;
+
+    // Queues of threads that are ready to run, but not running.
+    ReadyList readyList[NUM_READY_QUEUES];
+
+    /// Bit `i` is set if and only if `readyList[i]` is not empty.
+    uint64_t readyMask;
+
+    /// Time of the last aging pass.
+    unsigned long lastAging;
 
-	unsigned int startTime;
+    /// User and system ticks already charged to some thread.
+    unsigned long chargedUserTicks;
+    unsigned long chargedSystemTicks;
 };
 
 
@@ -73,6 +73,70 @@ Semaphore::P()
     interrupt->SetLevel(oldLevel);  // Re-enable interrupts.
 }
 
+static void
+SemaphoreTimeout(void *arg)
+{
+    ASSERT(arg != nullptr);
+    Semaphore::TimedWait *wait = (Semaphore::TimedWait *) arg;
+    wait->semaphore->TimeoutExpired(wait);
+}
+
+/// The timeout is an interrupt scheduled when the thread first has to wait;
+/// whoever is done with `TimedWait` last, the thread or the interrupt,
+/// frees it.
+bool
+Semaphore::P(unsigned long timeout)
+{
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+
+    TimedWait *wait = nullptr;
+    while (value == 0 && timeout > 0
+           && (wait == nullptr || !wait->expired)) {
+        if (wait == nullptr) {
+            wait = new TimedWait;
+            wait->semaphore = this;
+            wait->thread    = currentThread;
+            wait->expired   = false;
+            wait->done      = false;
+            interrupt->Schedule(SemaphoreTimeout, wait, timeout, WAIT_INT);
+        }
+        queue->Append(currentThread);
+        currentThread->Sleep();
+    }
+    bool taken = value > 0;
+    if (taken) {
+        value--;
+    }
+    if (wait != nullptr) {
+        if (wait->expired) {
+            delete wait;
+        } else {
+            wait->done = true;
+        }
+    }
+
+    interrupt->SetLevel(oldLevel);
+    return taken;
+}
+
+/// The thread is only made ready if it is still in the queue; a `V` may
+/// have woken it up already.
+void
+Semaphore::TimeoutExpired(TimedWait *wait)
+{
+    ASSERT(wait != nullptr);
+
+    if (wait->done) {
+        delete wait;
+        return;
+    }
+    wait->expired = true;
+    if (queue->Has(wait->thread)) {
+        queue->Remove(wait->thread);
+        scheduler->ReadyToRun(wait->thread);
+    }
+}
+
 /// Increment semaphore value, waking up a waiter if necessary.
 ///
 /// As with `P`, this operation must be atomic, so we need to disable
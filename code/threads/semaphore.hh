@@ -58,6 +58,21 @@ public:
     void P();
     void V();
 
+    /// The same as `P`, but give up once `timeout` ticks go by (at once, if
+    /// 0) with the value still zero.  Return whether it was decremented.
+    bool P(unsigned long timeout);
+
+    /// A thread in a timed `P`, as the timeout interrupt sees it.
+    struct TimedWait {
+        Semaphore *semaphore;
+        Thread *thread;
+        bool expired;  ///< The timeout interrupt came.
+        bool done;     ///< The thread is not waiting anymore.
+    };
+
+    /// Interrupt handler, called when the time of `wait` is over.
+    void TimeoutExpired(TimedWait *wait);
+
 private:
 
     /// For debugging.
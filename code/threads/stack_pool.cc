@@ -0,0 +1,96 @@
+/// Routines to manage the pool of thread stacks.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "stack_pool.hh"
+#include "system.hh"
+
+
+StackPool::StackPool(unsigned maxCached_)
+{
+    freeList  = nullptr;
+    cached    = 0;
+    maxCached = maxCached_;
+}
+
+StackPool::~StackPool()
+{
+    while (freeList != nullptr) {
+        FreeStack *s = freeList;
+        freeList = s->next;
+        SystemDep::DeallocGuardedStack((char *) s,
+                                       s->size * sizeof (uintptr_t));
+    }
+}
+
+/// Take the most recently freed stack of the right size; map a new one if
+/// there is none.
+///
+/// Interrupts must be disabled, as in `Thread::Fork`.  Turning them off
+/// here instead would advance the simulated clock on every fork.
+///
+/// * `size` is the size of the stack, in words.
+uintptr_t *
+StackPool::Get(unsigned size)
+{
+    ASSERT(size * sizeof (uintptr_t) >= sizeof (FreeStack));
+
+    ASSERT(interrupt->GetLevel() == INT_OFF);
+
+    FreeStack **link = &freeList;
+    while (*link != nullptr && (*link)->size != size) {
+        link = &(*link)->next;
+    }
+    FreeStack *s = *link;
+    if (s != nullptr) {
+        *link = s->next;
+        cached--;
+        stats->numStacksReused++;
+    }
+
+    if (s == nullptr) {
+        stats->numStacksAllocated++;
+        return (uintptr_t *)
+                 SystemDep::AllocGuardedStack(size * sizeof (uintptr_t));
+    }
+    return (uintptr_t *) s;
+}
+
+/// Keep `stack` for a later `Get`, unless the pool is full already.
+///
+/// Interrupts must be disabled; finished threads are deleted from
+/// `Scheduler::Run`, where they are.
+///
+/// * `stack` is the bottom of the stack, as returned by `Get`.
+/// * `size` is the size it was requested with, in words.
+void
+StackPool::Put(uintptr_t *stack, unsigned size)
+{
+    ASSERT(stack != nullptr);
+
+    ASSERT(interrupt->GetLevel() == INT_OFF);
+
+    bool keep = cached < maxCached;
+    if (keep) {
+        FreeStack *s = (FreeStack *) stack;
+        s->next  = freeList;
+        s->size  = size;
+        freeList = s;
+        cached++;
+    }
+
+    if (!keep) {
+        SystemDep::DeallocGuardedStack((char *) stack,
+                                       size * sizeof (uintptr_t));
+    }
+}
+
+unsigned
+StackPool::GetCached() const
+{
+    return cached;
+}
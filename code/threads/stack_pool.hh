@@ -0,0 +1,64 @@
+/// A pool of thread execution stacks.
+///
+/// Every `Fork` needs a stack and every finished thread gives one back.
+/// Going to the host allocator each time is wasteful when a test forks
+/// thousands of short-lived threads, so finished stacks are kept on a free
+/// list and handed out again to the next thread that asks for the same
+/// size.  The list is LIFO: the stack freed last is the one most likely to
+/// still be in the host caches.
+///
+/// Stacks are mapped with a guard page below them (see
+/// `SystemDep::AllocGuardedStack`), so an overflow faults at once instead
+/// of being noticed later by `Thread::CheckOverflow`.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_THREADS_STACKPOOL__HH
+#define NACHOS_THREADS_STACKPOOL__HH
+
+
+#include <stdint.h>
+
+
+/// Default number of free stacks kept around before they are given back
+/// to the host.
+const unsigned MAX_CACHED_STACKS = 64;
+
+class StackPool {
+public:
+
+    /// Initialize an empty pool that keeps at most `maxCached` free stacks.
+    StackPool(unsigned maxCached = MAX_CACHED_STACKS);
+
+    /// Give every cached stack back to the host.
+    ~StackPool();
+
+    /// Get a stack of `size` words, reusing a free one if possible.
+    ///
+    /// Returns the bottom of the stack (its lowest address).
+    uintptr_t *Get(unsigned size);
+
+    /// Return a stack of `size` words obtained from `Get`.
+    void Put(uintptr_t *stack, unsigned size);
+
+    /// Number of free stacks currently cached.
+    unsigned GetCached() const;
+
+private:
+
+    /// While on the free list, the bottom of a stack holds this header.
+    struct FreeStack {
+        FreeStack *next;
+        unsigned size;
+    };
+
+    FreeStack *freeList;
+    unsigned cached;
+    unsigned maxCached;
+};
+
+
+#endif
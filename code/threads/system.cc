@@ -12,6 +12,8 @@
 #ifdef USER_PROGRAM
 #include "userprog/debugger.hh"
 #include "userprog/exception.hh"
+#include "userprog/address_space.hh"
+#include "userprog/profiler.hh"
 
 #ifndef SWAP
 #include "lib/bitmap.hh"
@@ -36,6 +38,9 @@ Interrupt *interrupt;         ///< Interrupt status.
 Statistics *stats;            ///< Performance metrics.
 Timer *timer;                 ///< The hardware timer device, for invoking
                               ///< context switches.
+StackPool *stackPool;         ///< Stacks ready to be reused.
+Tracer *tracer = nullptr;     ///< Records events, when tracing.
+static const char *traceFile = nullptr;  ///< Where to save the trace.
 
 // 2007, Jose Miguel Santos Espino
 PreemptiveScheduler *preemptiveScheduler = nullptr;
@@ -57,6 +62,7 @@ Lock* filesysCreateLock;
 Machine *machine;  ///< User program memory and registers.
 SynchConsole* synchConsole;
 Table<Thread*> *threadUPS; //Ej 2. P3
+bool profiling = false;  ///< Sample user programs on timer interrupts.
 
 #ifndef SWAP
 Bitmap *paginaMapa;
@@ -68,11 +74,17 @@ Bitmap *paginaMapa;
 	#endif //DEMAND_LOADING
 #endif //SWAP
 
+#ifdef DEMAND_LOADING
+unsigned prefetchWindow = DEFAULT_PREFETCH_WINDOW;
+unsigned zeroFrame;  ///< Shared by every page that was never written.
+#endif
+
 
 #endif
 
 #ifdef NETWORK
 PostOffice *postOffice;
+SharedMemory *sharedMemory;
 #endif
 
 // External definition, to allow us to take a pointer to this function.
@@ -95,6 +107,14 @@ extern void Cleanup();
 static void
 TimerInterruptHandler(void *dummy)
 {
+#ifdef USER_PROGRAM
+    // Take a sample of the user program that was interrupted, if profiled.
+    if (interrupt->GetInterruptedStatus() == USER_MODE
+          && currentThread->space != nullptr
+          && currentThread->space->profiler != nullptr) {
+        currentThread->space->profiler->Sample(currentThread->space);
+    }
+#endif
     if (interrupt->GetStatus() != IDLE_MODE) {
         interrupt->YieldOnReturn();
     }
@@ -154,6 +174,7 @@ Initialize(int argc, char **argv)
     const char *debugFlags = "";
     DebugOpts debugOpts;
     bool randomYield = false;
+    bool printSpeed = false;
 
     // 2007, Jose Miguel Santos Espino
     bool preemptiveScheduling = false;
@@ -161,6 +182,7 @@ Initialize(int argc, char **argv)
 
 #ifdef USER_PROGRAM
     bool debugUserProg = false;  // Single step user program.
+    bool rawConsole = false;  // Console input not in line mode.
 #endif
 #ifdef FILESYS_NEEDED
     bool format = false;  // Format disk.
@@ -168,6 +190,7 @@ Initialize(int argc, char **argv)
 #ifdef NETWORK
     double rely = 1;  // Network reliability.
     int netname = 0;  // UNIX socket name.
+    unsigned sharedMachines = 0;  // Machines sharing memory; none if 0.
 #endif
 
     for (argc--, argv++; argc > 0; argc -= argCount, argv += argCount) {
@@ -191,6 +214,14 @@ Initialize(int argc, char **argv)
             randomYield = true;
             argCount = 2;
         }
+        else if (!strcmp(*argv, "-ips")) {
+            printSpeed = true;
+        }
+        else if (!strcmp(*argv, "-tr")) {
+            ASSERT(argc > 1);
+            traceFile = *(argv + 1);
+            argCount = 2;
+        }
         // 2007, Jose Miguel Santos Espino
         else if (!strcmp(*argv, "-p")) {
             preemptiveScheduling = true;
@@ -204,6 +235,18 @@ Initialize(int argc, char **argv)
 #ifdef USER_PROGRAM
         if (!strcmp(*argv, "-s")) {
             debugUserProg = true;
+        } else if (!strcmp(*argv, "-cr")) {
+            rawConsole = true;
+        } else if (!strcmp(*argv, "-pf")) {
+            profiling = true;
+        }
+#endif
+#ifdef DEMAND_LOADING
+        if (!strcmp(*argv, "-pw")) {
+            ASSERT(argc > 1);
+            prefetchWindow = atoi(*(argv + 1));
+            ASSERT(prefetchWindow > 0);
+            argCount = 2;
         }
 #endif
 #ifdef FILESYS_NEEDED
@@ -220,6 +263,10 @@ Initialize(int argc, char **argv)
             ASSERT(argc > 1);
             netname = atoi(*(argv + 1));
             argCount = 2;
+        } else if (!strcmp(*argv, "-dsm")) {
+            ASSERT(argc > 1);
+            sharedMachines = atoi(*(argv + 1));
+            argCount = 2;
         }
 #endif
     }
@@ -227,8 +274,13 @@ Initialize(int argc, char **argv)
     debug.SetFlags(debugFlags);  // Initialize `DEBUG` messages.
     debug.SetOpts(debugOpts);    // Set debugging behavior.
     stats = new Statistics;      // Collect statistics.
+    stats->printSpeed = printSpeed;
+    if (traceFile != nullptr) {  // Before any thread or lock is created.
+        tracer = new Tracer(&stats->totalTicks);
+    }
     interrupt = new Interrupt;   // Start up interrupt handling.
     scheduler = new Scheduler;   // Initialize the ready queue.
+    stackPool = new StackPool;   // Recycle thread stacks.
 
 #ifdef USER_PROGRAM
     timer = new Timer(TimerInterruptHandler, 0, randomYield);
@@ -269,7 +321,22 @@ Initialize(int argc, char **argv)
 	paginaMapa = new Coremap(NUM_PHYS_PAGES);
 		#endif
     #endif
+    #ifdef DEMAND_LOADING
+        // Untouched BSS and stack pages are all mapped read-only onto this
+        // frame, so it must stay full of zeroes and never be evicted.
+        #ifdef SWAP
+        zeroFrame = NUM_PHYS_PAGES - 1;
+        paginaMapa->Reserve(zeroFrame);
+        #else
+        int frame = paginaMapa->Find();
+        ASSERT(frame != -1);
+        zeroFrame = frame;
+        #endif
+        memset(&machine->GetMMU()->mainMemory[zeroFrame * PAGE_SIZE], 0,
+               PAGE_SIZE);
+    #endif
     synchConsole = new SynchConsole(NULL,NULL);
+    synchConsole->SetLineMode(!rawConsole);
 #endif
 
 #ifdef FILESYS
@@ -295,6 +362,11 @@ Initialize(int argc, char **argv)
 
 #ifdef NETWORK
     postOffice = new PostOffice(netname, rely, 10);
+    if (sharedMachines > 0) {
+        // Mail about shared pages is never retransmitted.
+        ASSERT(rely >= 1);
+        sharedMemory = new SharedMemory(sharedMachines);
+    }
 #endif
 }
 
@@ -343,8 +415,15 @@ Cleanup()
     ///
 #endif
 
+    if (tracer != nullptr) {
+        tracer->Write(traceFile);
+        delete tracer;
+        tracer = nullptr;
+    }
+
     delete timer;
     delete scheduler;
+    delete stackPool;
 	delete stats;
 	delete interrupt;
 
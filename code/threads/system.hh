@@ -11,10 +11,12 @@
 
 #include "thread.hh"
 #include "scheduler.hh"
+#include "stack_pool.hh"
 #include "lib/utility.hh"
 #include "machine/interrupt.hh"
 #include "machine/statistics.hh"
 #include "machine/timer.hh"
+#include "machine/trace.hh"
 #include "userprog/synch_console.hh"
 
 /// Initialization and cleanup routines.
@@ -32,12 +34,16 @@ extern Scheduler *scheduler;         ///< The ready list.
 extern Interrupt *interrupt;         ///< Interrupt status.
 extern Statistics *stats;            ///< Performance metrics.
 extern Timer *timer;                 ///< The hardware alarm clock.
+extern StackPool *stackPool;         ///< Stacks of finished threads.
+extern Tracer *tracer;               ///< Event recorder, null if not
+                                     ///< tracing.
 
 #ifdef USER_PROGRAM
     #include "machine/machine.hh"
     extern Machine *machine;  // User program memory and registers.
     extern SynchConsole *synchConsole;
     extern Table<Thread*> * threadUPS;
+    extern bool profiling;  // Sample user programs to profile them.
     #ifndef SWAP
         #include "lib/bitmap.hh"
         extern Bitmap *paginaMapa;
@@ -50,6 +56,10 @@ extern Timer *timer;                 ///< The hardware alarm clock.
 	        extern Coremap *paginaMapa;
 		#endif //DEMAND_LOADING
     #endif //SWAP
+    #ifdef DEMAND_LOADING
+        extern unsigned prefetchWindow;  // Pages per fault-around window.
+        extern unsigned zeroFrame;  // Read-only frame full of zeroes.
+    #endif
 
 #endif
 
@@ -78,7 +88,9 @@ extern Lock* filesysCreateLock;
 
 #ifdef NETWORK
 #include "network/post.hh"
+#include "network/shared_memory.hh"
 extern PostOffice *postOffice;
+extern SharedMemory *sharedMemory;  // Null unless started with `-dsm`.
 #endif
 
 
@@ -31,12 +31,21 @@
 const unsigned STACK_FENCEPOST = 0xDEADBEEF;
 
 
+/// Every thread in the system, from creation to deletion.
+static IntrusiveList<Thread, &Thread::allLink> allThreads;
+
 static inline bool
 IsThreadStatus(ThreadStatus s)
 {
     return 0 <= s && s < NUM_THREAD_STATUS;
 }
 
+Thread *
+Thread::FirstThread()
+{
+    return allThreads.Head();
+}
+
 /// Initialize a thread control block, so that we can then call
 /// `Thread::Fork`.
 ///
@@ -47,8 +56,12 @@ Thread::Thread(const char *threadName, bool joinableThread, unsigned int priorit
 	priority = priorityThread;
     stackTop = nullptr;
     stack    = nullptr;
+    stackSize = STACK_SIZE;
     status   = JUST_CREATED;
     joinable = joinableThread;
+    traceId  = tracer != nullptr ? tracer->NewThread(threadName) : 0;
+    usage    = ThreadUsage();
+    allThreads.Append(this);
     if(joinable) {
 	    threadChannel = new Channel("Canal del thread");
 	}
@@ -84,9 +97,9 @@ Thread::~Thread()
 
     ASSERT(this != currentThread);
     if (stack != nullptr) {
-        SystemDep::DeallocBoundedArray((char *) stack,
-                                       STACK_SIZE * sizeof *stack);
+        stackPool->Put(stack, stackSize);
     }
+    allThreads.Remove(this);
 
 
 #ifdef USER_PROGRAM
@@ -104,6 +117,11 @@ Thread::~Thread()
    if(joinable) {
 	    delete threadChannel;
     }
+    while (inheritedPriorities != nullptr) {
+        PriorityInheritanceList *next = inheritedPriorities->next;
+        delete inheritedPriorities;
+        inheritedPriorities = next;
+    }
 #ifdef FILESYS
     delete removeChannel;
 #endif
@@ -133,9 +151,8 @@ Thread::Fork(VoidFunctionPtr func, void *arg)
     DEBUG('t', "Forking thread \"%s\" with func = %p, arg = %p\n",
           name, func, arg);
 
-    StackAllocate(func, arg);
-
     IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    StackAllocate(func, arg);     // The stack pool also needs them off.
     scheduler->ReadyToRun(this);  // `ReadyToRun` assumes that interrupts
                                   // are disabled!
     interrupt->SetLevel(oldLevel);
@@ -161,6 +178,23 @@ Thread::CheckOverflow() const
     }
 }
 
+/// Choose the size of the stack that `Fork` will allocate.
+///
+/// * `size` is in words, like `STACK_SIZE`.
+void
+Thread::SetStackSize(unsigned size)
+{
+    ASSERT(stack == nullptr);
+    ASSERT(size > 4);
+    stackSize = size;
+}
+
+unsigned
+Thread::GetStackSize() const
+{
+    return stackSize;
+}
+
 void
 Thread::SetStatus(ThreadStatus st)
 {
@@ -168,6 +202,12 @@ Thread::SetStatus(ThreadStatus st)
     status = st;
 }
 
+ThreadStatus
+Thread::GetStatus() const
+{
+    return status;
+}
+
 void
 Thread::SetPreAssignedQueue(unsigned int index) {
 	preassignedQueue = index;
@@ -224,6 +264,7 @@ Thread::Finish(int returnValue)
     if(tId == 0){
   //      interrupt->Halt();
         consoleON = true;
+        synchConsole->Flush();  // Nachos halts once nobody else is ready.
     }
     ///
  //      threadUPS->Remove(tId); // Si muere el Main muere todo
@@ -271,8 +312,6 @@ Thread::Yield()
 
     ASSERT(this == currentThread);
 
-	SetPreAssignedQueue(1); //Descend if work is slow
-
     DEBUG('t', "Yielding thread \"%s\"\n", GetName());
 
     Thread *nextThread = scheduler->FindNextToRun();
@@ -284,6 +323,24 @@ Thread::Yield()
     interrupt->SetLevel(oldLevel);
 }
 
+/// Like `Yield`, but called when the thread's quantum expired rather than
+/// by the thread itself, so the thread drops one level in its band.  A
+/// thread that gives up the CPU early keeps its level.
+void
+Thread::Preempt()
+{
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+
+    ASSERT(this == currentThread);
+
+	if (GetPreAssignedQueue() + 1 < MLFQ_LEVELS)
+		SetPreAssignedQueue(GetPreAssignedQueue() + 1); //Descend if work is slow
+
+    Yield();
+
+    interrupt->SetLevel(oldLevel);
+}
+
 /// Relinquish the CPU, because the current thread is blocked waiting on a
 /// synchronization variable (`Semaphore`, `Lock`, or `Condition`).
 /// Eventually, some thread will wake this thread up, and put it back on the
@@ -317,7 +374,7 @@ Thread::Sleep(bool consoleON)
     scheduler->Run(nextThread);
 }
 
-/// ThreadFinish, InterruptEnable
+/// ThreadFinish, ThreadBegin
 ///
 /// Dummy functions because C++ does not allow a pointer to a member
 /// function.  So in order to do this, we create a dummy C function (which we
@@ -328,9 +385,12 @@ ThreadFinish()
     currentThread->Finish();
 }
 
+/// First thing a new thread does: clean up after the thread that finished
+/// into it, then enable interrupts.
 static void
-InterruptEnable()
+ThreadBegin()
 {
+    scheduler->DestroyFinished();
     interrupt->Enable();
 }
 
@@ -350,7 +410,7 @@ Thread::Join()
 	delete msg;
 
 	///
-	Thread* isEmp = scheduler->FindNextToRun();
+	Thread* isEmp = scheduler->PeekNextToRun();
 	///
 	 if(currentThread->tId == 0 && isEmp != nullptr && isEmp->tId != 0)
         currentThread->Yield();
@@ -362,19 +422,23 @@ Thread::Join()
 void
 Thread::SetInheritedPriority(Lock* lock, int newPriority)
 {
-	if(inheritedPriorities == nullptr) {
-		inheritedPriorities = new PriorityInheritanceList;
-		inheritedPriorities->lock = lock;
-		inheritedPriorities->priority = newPriority;
-		inheritedPriorities->next = nullptr;
-		return;
-	}
-
+	// Entries released by `RemoveInheritedPriority` are reused before
+	// allocating new ones.
+	PriorityInheritanceList* unused = nullptr;
 	for (PriorityInheritanceList* i = inheritedPriorities; i != nullptr; i = i->next) {
 		if(i->lock == lock) {
 			i->priority = newPriority;
 			return;
 		}
+		if(i->lock == nullptr && unused == nullptr) {
+			unused = i;
+		}
+	}
+
+	if(unused != nullptr) {
+		unused->lock = lock;
+		unused->priority = newPriority;
+		return;
 	}
 
 	PriorityInheritanceList *newElement = new PriorityInheritanceList;
@@ -408,11 +472,10 @@ Thread::StackAllocate(VoidFunctionPtr func, void *arg)
 {
     ASSERT(func != nullptr);
 
-    stack = (uintptr_t *)
-              SystemDep::AllocBoundedArray(STACK_SIZE * sizeof *stack);
+    stack = stackPool->Get(stackSize);
 
     // Stacks in x86 work from high addresses to low addresses.
-    stackTop = stack + STACK_SIZE - 4;  // -4 to be on the safe side!
+    stackTop = stack + stackSize - 4;  // -4 to be on the safe side!
 
     // x86 passes the return address on the stack.  In order for `SWITCH` to
     // go to `ThreadRoot` when we switch to this thread, the return address
@@ -422,7 +485,7 @@ Thread::StackAllocate(VoidFunctionPtr func, void *arg)
     *stack = STACK_FENCEPOST;
 
     machineState[PCState]         = (uintptr_t) ThreadRoot;
-    machineState[StartupPCState]  = (uintptr_t) InterruptEnable;
+    machineState[StartupPCState]  = (uintptr_t) ThreadBegin;
     machineState[InitialPCState]  = (uintptr_t) func;
     machineState[InitialArgState] = (uintptr_t) arg;
     machineState[WhenDonePCState] = (uintptr_t) ThreadFinish;
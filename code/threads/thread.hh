@@ -22,7 +22,10 @@
 /// small.)
 ///
 /// One thing to try if you find yourself with segmentation faults is to
-/// increase the size of thread stack -- `STACK_SIZE`.
+/// increase the size of thread stack -- `STACK_SIZE`, or
+/// `Thread::SetStackSize` for a single thread.  Stacks have an unmapped
+/// guard page right below them, so a fault whose address is just under a
+/// thread's `stack` is an overflow.
 ///
 /// In this interface, forking a thread takes two steps.  We must first
 /// allocate a data structure for it:
@@ -38,14 +41,13 @@
 #ifndef NACHOS_THREADS_THREAD__HH
 #define NACHOS_THREADS_THREAD__HH
 
-#include "channel.hh"
-
-#include "lock.hh"
 #include "lib/utility.hh"
+#include "lib/intrusive_list.hh"
 #include <cstdlib>
 #ifdef USER_PROGRAM
 #include "machine/machine.hh"
 #include "userprog/address_space.hh"
+#include "userprog/syscall.h"
 #include "lib/table.hh"
 #endif
 
@@ -76,6 +78,19 @@ enum ThreadStatus {
     NUM_THREAD_STATUS
 };
 
+/// Resources used by a thread, as reported by the `Ps` system call.  Page
+/// faults and swapping are kept by the `AddressSpace` instead.
+struct ThreadUsage {
+    unsigned long userTicks;
+    unsigned long systemTicks;
+    unsigned long switches;  ///< Times the thread was given the CPU.
+    unsigned long sectorsRead;
+    unsigned long sectorsWritten;
+#ifdef USER_PROGRAM
+    unsigned long syscalls[SC_COUNT];  ///< Indexed by system call id.
+#endif
+};
+
 struct PriorityInheritanceList {
 	Lock* lock = nullptr;
 	int priority;
@@ -127,6 +142,9 @@ public:
     /// Relinquish the CPU if any other thread is runnable.
     void Yield();
 
+    /// Relinquish the CPU because the time slice is over.
+    void Preempt();
+
     /// Put the thread to sleep and relinquish the processor.
     void Sleep(bool consoleON = false);
 
@@ -136,8 +154,17 @@ public:
     /// Check if thread has overflowed its stack.
     void CheckOverflow() const;
 
+    /// Size of the stack that `Fork` will give the thread, in words.
+    ///
+    /// Must be set before `Fork`; defaults to `STACK_SIZE`.
+    void SetStackSize(unsigned size);
+
+    unsigned GetStackSize() const;
+
     void SetStatus(ThreadStatus st);
 
+    ThreadStatus GetStatus() const;
+
     void SetPreAssignedQueue(unsigned int index);
 	unsigned int GetPreAssignedQueue() const;
 
@@ -153,6 +180,28 @@ public:
 
 	void RemoveInheritedPriority(Lock* lock);
 
+    /// Link for the ready queue of the scheduler.  A thread is in at
+    /// most one ready queue at a time, so no allocation is needed to make
+    /// it ready.
+    ListLink<Thread> readyLink;
+
+    /// Link for the queue of threads waiting for a `Lock`.
+    ListLink<Thread> waitLink;
+
+    /// Identifies the thread in traces.
+    unsigned traceId;
+
+    /// What the thread has used so far.  The ticks are brought up to date
+    /// by `Scheduler::ChargeTime`.
+    ThreadUsage usage;
+
+    /// Link for the list of all threads in the system.
+    ListLink<Thread> allLink;
+
+    /// The first of all the threads in the system; follow `allLink` for
+    /// the rest.
+    static Thread *FirstThread();
+
 //Identify of Thread's Space Memory --Ej2 P3
     int tId;
 ///
@@ -166,6 +215,9 @@ private:
     /// Null if this is the main thread.  (If null, do not deallocate stack.)
     uintptr_t *stack;
 
+    /// Size of `stack`, in words.
+    unsigned stackSize;
+
     /// Ready, running or blocked.
     ThreadStatus status;
 
@@ -187,6 +239,8 @@ private:
 	/// locking thread
     PriorityInheritanceList* inheritedPriorities;
 
+	/// Feedback level used by the scheduler inside the priority band of
+	/// the thread; 0 is the top level.
 	unsigned int preassignedQueue = 0;
 ///
 #ifdef FILESYS
@@ -235,5 +289,10 @@ extern "C" {
     void SWITCH(Thread *oldThread, Thread *newThread);
 }
 
+// Included last: `Lock` keeps its waiters on `Thread::waitLink`, so it needs
+// the complete `Thread`.
+#include "channel.hh"
+#include "lock.hh"
+
 
 #endif
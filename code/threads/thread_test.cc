@@ -19,6 +19,8 @@
 #include "thread_test_garden_mutex.hh"
 #include "thread_test_garden_join.hh"
 #include "thread_test_multithread_join.hh"
+#include "thread_test_bench.hh"
+#include "thread_test_channel.hh"
 
 #include "lib/utility.hh"
 
@@ -42,6 +44,10 @@ static const Test TESTS[] = {
     { &ThreadTestProdCons, "prodcons", "Producer/Consumer" },
     { &ThreadTestProdConsPriorities, "prodcons priorities", "Producer/Consumer with priorities" },
     { &ThreadTestMutlithreadJoin, "multithread join", "Multiple threads wait for one" },
+    { &ThreadTestPingPong, "ping pong", "Semaphore P/V ping-pong benchmark" },
+    { &ThreadTestSwitch, "switch cost", "Context switch benchmark" },
+    { &ThreadTestForkChurn, "fork churn", "Thread creation and teardown benchmark" },
+    { &ThreadTestChannel, "channels", "Producer/consumer over rendezvous, buffered and selected channels" },
 };
 static const unsigned NUM_TESTS = sizeof TESTS / sizeof TESTS[0];
 
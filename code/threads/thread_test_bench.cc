@@ -0,0 +1,133 @@
+/// Micro-benchmarks for the thread system.
+///
+/// Each test runs one operation many times and reports its cost through a
+/// `Benchmark`.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2007-2009 Universidad de Las Palmas de Gran Canaria.
+///               2016-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "thread_test_bench.hh"
+#include "benchmark.hh"
+#include "semaphore.hh"
+#include "system.hh"
+
+#include <stdio.h>
+
+
+/// Ping-pong.
+///
+/// Every round trip blocks and wakes each thread once, so the time per
+/// round trip is a measure of the cost of `Semaphore::P`, `Semaphore::V`,
+/// the ready queue and the context switch.
+
+static const unsigned ROUND_TRIPS = 200000;
+
+static Semaphore ping("Ping", 0);
+static Semaphore pong("Pong", 0);
+
+static void
+Ponger(void *)
+{
+    for (unsigned i = 0; i < ROUND_TRIPS; i++) {
+        ping.P();
+        pong.V();
+    }
+}
+
+void
+ThreadTestPingPong()
+{
+    Thread *ponger = new Thread("Ponger", true);
+    ponger->Fork(Ponger, nullptr);
+
+    Benchmark bench("Ping-pong");
+    for (unsigned i = 0; i < ROUND_TRIPS; i++) {
+        ping.V();
+        pong.P();
+    }
+    bench.Report(ROUND_TRIPS, "round trip");
+
+    ponger->Join();
+}
+
+
+/// Context switch.
+
+static const unsigned YIELDS = 200000;
+
+static void
+Yielder(void *)
+{
+    for (unsigned i = 0; i < YIELDS; i++) {
+        currentThread->Yield();
+    }
+}
+
+void
+ThreadTestSwitch()
+{
+    Benchmark alone("Yield with nobody ready");
+    for (unsigned i = 0; i < YIELDS; i++) {
+        currentThread->Yield();
+    }
+    alone.Report(YIELDS, "yield");
+
+    Thread *first  = new Thread("Yielder 1", true);
+    Thread *second = new Thread("Yielder 2", true);
+    first->Fork(Yielder, nullptr);
+    second->Fork(Yielder, nullptr);
+
+    Benchmark together("Switch between two threads");
+    first->Join();
+    second->Join();
+    together.Report(2 * YIELDS, "switch");
+}
+
+
+/// Fork churn.
+///
+/// The workers do nothing but signal a semaphore and finish, so almost all
+/// the work is creating a thread, giving it a stack and tearing it down.
+/// Every other thread asks for a smaller stack, so the pool has to keep two
+/// sizes apart.
+
+static const unsigned ROUNDS = 2500;
+static const unsigned BATCH  = 8;
+
+static Semaphore done("Churn done", 0);
+
+static void
+Worker(void *)
+{
+    done.V();
+}
+
+void
+ThreadTestForkChurn()
+{
+    unsigned long allocated = stats->numStacksAllocated;
+    unsigned long reused    = stats->numStacksReused;
+
+    Benchmark bench("Fork churn");
+    for (unsigned r = 0; r < ROUNDS; r++) {
+        for (unsigned i = 0; i < BATCH; i++) {
+            Thread *t = new Thread("Churn worker");
+            if (i % 2 == 1) {
+                t->SetStackSize(STACK_SIZE / 4);
+            }
+            t->Fork(Worker, nullptr);
+        }
+        for (unsigned i = 0; i < BATCH; i++) {
+            done.P();
+        }
+    }
+    bench.Report(ROUNDS * BATCH, "thread");
+
+    printf("Fork churn: stacks allocated %lu, reused %lu\n",
+           stats->numStacksAllocated - allocated,
+           stats->numStacksReused - reused);
+}
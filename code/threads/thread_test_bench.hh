@@ -0,0 +1,22 @@
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2007-2009 Universidad de Las Palmas de Gran Canaria.
+///               2016-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_THREADS_THREADTESTBENCH__HH
+#define NACHOS_THREADS_THREADTESTBENCH__HH
+
+
+/// Two threads bounce a token through a pair of semaphores.
+void ThreadTestPingPong();
+
+/// Measures `Thread::Yield` with nobody else ready, and the switch between
+/// two threads that keep yielding to each other.
+void ThreadTestSwitch();
+
+/// Forks batches of threads that finish at once.
+void ThreadTestForkChurn();
+
+
+#endif
@@ -0,0 +1,163 @@
+/// Producer/consumer over channels.
+///
+/// The same stream of numbers goes through a rendezvous channel, a
+/// buffered one, and a buffered one in batches; the ticks taken by each
+/// show what pipelining buys.  Then two producers feed one consumer that
+/// uses `Channel::Select`, and the non-blocking operations are checked.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2007-2009 Universidad de Las Palmas de Gran Canaria.
+///               2016-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "thread_test_channel.hh"
+#include "channel.hh"
+#include "system.hh"
+
+#include <stdio.h>
+
+
+static const int ITEMS = 5000;
+static const unsigned BATCH = 16;
+
+struct Pipe {
+    Channel *channel;
+    bool batched;
+    int first;  ///< Numbers sent are `first`, ..., `first + ITEMS - 1`.
+};
+
+static void
+Producer(void *arg)
+{
+    Pipe *pipe = (Pipe *) arg;
+    if (pipe->batched) {
+        int batch[BATCH];
+        for (int i = 0; i < ITEMS; i += BATCH) {
+            unsigned n = 0;
+            for (; n < BATCH && i + (int) n < ITEMS; n++) {
+                batch[n] = pipe->first + i + n;
+            }
+            pipe->channel->SendN(batch, n);
+        }
+    } else {
+        for (int i = 0; i < ITEMS; i++) {
+            pipe->channel->Send(pipe->first + i);
+        }
+    }
+}
+
+static long
+Consume(Pipe *pipe)
+{
+    long sum = 0;
+    int received = 0;
+    while (received < ITEMS) {
+        int batch[BATCH];
+        unsigned n = 1;
+        if (pipe->batched) {
+            n = pipe->channel->ReceiveN(batch, BATCH);
+        } else {
+            pipe->channel->Receive(batch);
+        }
+        for (unsigned k = 0; k < n; k++) {
+            ASSERT(batch[k] == pipe->first + received);  // In order.
+            sum += batch[k];
+            received++;
+        }
+    }
+    return sum;
+}
+
+static void
+RunPipe(const char *title, unsigned capacity, bool batched)
+{
+    Channel channel("Pipe", capacity);
+    Pipe pipe = { &channel, batched, 0 };
+
+    unsigned long start = stats->totalTicks;
+    Thread *producer = new Thread("Producer", true);
+    producer->Fork(Producer, &pipe);
+    long sum = Consume(&pipe);
+    producer->Join();
+
+    ASSERT(sum == (long) ITEMS * (ITEMS - 1) / 2);
+    printf("Channel %s: %d messages, %lu ticks\n",
+           title, ITEMS, stats->totalTicks - start);
+}
+
+static void
+RunSelect()
+{
+    Channel a("Select A", 8), b("Select B");
+    Pipe pipeA = { &a, false, 0 };
+    Pipe pipeB = { &b, false, ITEMS };
+
+    Thread *producerA = new Thread("Producer A", true);
+    Thread *producerB = new Thread("Producer B", true);
+    producerA->Fork(Producer, &pipeA);
+    producerB->Fork(Producer, &pipeB);
+
+    Channel *channels[] = { &a, &b };
+    int next[2] = { 0, ITEMS };
+    for (int i = 0; i < 2 * ITEMS; i++) {
+        int mensaje;
+        unsigned from = Channel::Select(channels, 2, &mensaje);
+        ASSERT(mensaje == next[from]++);
+    }
+    producerA->Join();
+    producerB->Join();
+
+    ASSERT(next[0] == ITEMS && next[1] == 2 * ITEMS);
+    printf("Channel select: %d messages from two channels\n", 2 * ITEMS);
+}
+
+static void
+SelectOnce(void *channels)
+{
+    int mensaje;
+    unsigned from = Channel::Select((Channel **) channels, 2, &mensaje);
+    ASSERT(from == 1 && mensaje == 3);
+}
+
+static void
+RunNonBlocking()
+{
+    int mensaje;
+
+    Channel buffered("Try buffered", 2);
+    ASSERT(!buffered.TryReceive(&mensaje));
+    ASSERT(buffered.TrySend(1));
+    ASSERT(buffered.TrySend(2));
+    ASSERT(!buffered.TrySend(3));  // Full.
+    ASSERT(buffered.TryReceive(&mensaje) && mensaje == 1);
+    ASSERT(buffered.TryReceive(&mensaje) && mensaje == 2);
+
+    Channel rendezvous("Try rendezvous");
+    ASSERT(!rendezvous.TrySend(1));  // Nobody is receiving.
+    ASSERT(!rendezvous.TryReceive(&mensaje));
+
+    // A thread in `Select` may take its message from elsewhere, so it is
+    // not a receiver the rendezvous can count on.
+    Channel other("Try other", 1);
+    Channel *channels[] = { &rendezvous, &other };
+    Thread *selector = new Thread("Selector", true);
+    selector->Fork(SelectOnce, channels);
+    currentThread->Yield();  // Let it register and sleep.
+    ASSERT(!rendezvous.TrySend(2));
+    other.Send(3);
+    selector->Join();
+
+    printf("Channel non-blocking operations: ok\n");
+}
+
+void
+ThreadTestChannel()
+{
+    RunPipe("rendezvous", 0, false);
+    RunPipe("capacity 64", 64, false);
+    RunPipe("capacity 64, batches of 16", 64, true);
+    RunSelect();
+    RunNonBlocking();
+}
@@ -0,0 +1,43 @@
+/// Takes turns with the other machines incrementing a counter in the
+/// shared region.
+///
+/// Usage: `dsm_counter [rounds]`, on every machine started with `-dsm`;
+/// by default, 10 rounds.  Machine `m` increments the counter whenever it
+/// leaves `m` when divided by the number of machines, so each machine
+/// waits for the others in turn.
+
+#include "syscall.h"
+#include "lib.c"
+
+int
+main(int argc, char *argv[])
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 10;
+    int machine, machines;
+    volatile int *counter = (volatile int *) SharedRegion(&machine,
+                                                          &machines);
+    if (counter == 0) {
+        puts2("dsm_counter: no shared region, start Nachos with -dsm.\n");
+        return 1;
+    }
+
+    int total = rounds * machines;
+    for (int i = 0; i < rounds; i++) {
+        while (*counter % machines != machine) {
+            Yield();
+        }
+        *counter = *counter + 1;
+    }
+    while (*counter < total) {
+        Yield();
+    }
+
+    puts2("Counter at ");
+    putu(*counter, 0);
+    puts2(" after ");
+    putu(rounds, 0);
+    puts2(" rounds on ");
+    putu(machines, 0);
+    puts2(" machines.\n");
+    return *counter != total;
+}
@@ -1,31 +1,31 @@
 /// Outputs arguments entered on the command line.
+///
+/// The line is put together first and written at once, rather than with a
+/// `Write` per argument.
 
 #include "syscall.h"
 
 
-unsigned
-StringLength(const char *s)
-{
-    // What if `s` is null?
+#define LINE_SIZE  128
 
-    unsigned i;
-    for (i = 0; s[i] != '\0'; i++) {}
-    return i;
-}
+static char line[LINE_SIZE];
+static unsigned used;
 
-int
-PrintString(const char *s)
+/// Write what is in `line` with a single system call.
+static void
+Flush(void)
 {
-    // What if `s` is null?
-
-    unsigned len = StringLength(s);
-    return Write(s, len, CONSOLE_OUTPUT);
+    Write(line, used, CONSOLE_OUTPUT);
+    used = 0;
 }
 
-int
-PrintChar(char c)
+static void
+PutChar(char c)
 {
-    return Write(&c, 1, CONSOLE_OUTPUT);
+    if (used == LINE_SIZE) {
+        Flush();
+    }
+    line[used++] = c;
 }
 
 int
@@ -33,9 +33,12 @@ main(int argc, char *argv[])
 {
     for (unsigned i = 1; i < argc; i++) {
         if (i != 1) {
-            PrintChar(' ');
+            PutChar(' ');
+        }
+        for (const char *s = argv[i]; *s != '\0'; s++) {
+            PutChar(*s);
         }
-        PrintString(argv[i]);
     }
-    PrintChar('\n');
+    PutChar('\n');
+    Flush();
 }
@@ -0,0 +1,55 @@
+/// Sends messages to an `echo_server` and checks the answers.
+///
+/// Usage: `echo_client [machine] [box] [count]`; by default, 16 messages
+/// to box 1 of machine 0.  Messages lost on the way are waited for up to a
+/// timeout, and counted.
+
+#include "syscall.h"
+#include "lib.c"
+
+#define CLIENT_BOX  2
+#define TIMEOUT     100000
+
+static Message message;
+static char data[MAX_MESSAGE_SIZE];
+
+int
+main(int argc, char *argv[])
+{
+    int machine = argc > 1 ? atoi(argv[1]) : 0;
+    int box     = argc > 2 ? atoi(argv[2]) : 1;
+    int count   = argc > 3 ? atoi(argv[3]) : 16;
+    if (Bind(CLIENT_BOX) < 0) {
+        puts2("echo_client: cannot bind the mail box.\n");
+        return 1;
+    }
+
+    int answered = 0, wrong = 0;
+    for (int i = 0; i < count; i++) {
+        int size = 1 + i * 37 % MAX_MESSAGE_SIZE;
+        for (int j = 0; j < size; j++) {
+            data[j] = 'a' + (i + j) % 26;
+        }
+        Send(data, size, CLIENT_BOX, MAIL_ADDRESS(machine, box));
+
+        if (Receive(&message, CLIENT_BOX, TIMEOUT) < 0) {
+            continue;
+        }
+        answered++;
+        int same = message.length == size;
+        for (int j = 0; same && j < size; j++) {
+            same = message.data[j] == data[j];
+        }
+        if (!same) {
+            wrong++;
+        }
+    }
+
+    putu(answered, 0);
+    puts2(" of ");
+    putu(count, 0);
+    puts2(" messages answered, ");
+    putu(wrong, 0);
+    puts2(" wrong.\n");
+    return wrong != 0 || answered != count;
+}
@@ -0,0 +1,24 @@
+/// Answers every message that arrives at a mailbox with the same message.
+///
+/// Usage: `echo_server [box]`; box 1 by default.
+
+#include "syscall.h"
+#include "lib.c"
+
+static Message message;
+
+int
+main(int argc, char *argv[])
+{
+    int box = argc > 1 ? atoi(argv[1]) : 1;
+    if (Bind(box) < 0) {
+        puts2("echo_server: cannot bind the mail box.\n");
+        return 1;
+    }
+
+    for (;;) {
+        if (Receive(&message, box, RECEIVE_FOREVER) >= 0) {
+            Send(message.data, message.length, box, message.from);
+        }
+    }
+}
@@ -33,6 +33,40 @@ itoa(int n, char *str)
 	str[base_10_strlen] = '\0';
 }
 
+// Reads a decimal number, with an optional leading '-', from the start of
+// `s`; stops at the first character that is not a digit.
+int
+atoi(const char *s)
+{
+	int sign = 1, n = 0;
+	if (*s == '-') {
+		sign = -1;
+		s++;
+	}
+	for (; *s >= '0' && *s <= '9'; s++) {
+		n = 10 * n + *s - '0';
+	}
+	return sign * n;
+}
+
+// Writes `n` in decimal, padded with spaces on the left to at least `width`
+// characters.
+void
+putu(unsigned n, unsigned width)
+{
+	char buffer[12];
+	unsigned i = sizeof buffer - 1;
+	buffer[i] = '\0';
+	do {
+		buffer[--i] = '0' + n % 10;
+		n /= 10;
+	} while (n > 0);
+	for (unsigned len = sizeof buffer - 1 - i; len < width; len++) {
+		Write(" ", 1, CONSOLE_OUTPUT);
+	}
+	puts2(&buffer[i]);
+}
+
 char
 strcmpp(const char *s1, const char *s2)
 {
@@ -0,0 +1,58 @@
+/// Lists the threads in the system with the resources each one has used.
+
+#include "syscall.h"
+#include "lib.c"
+
+#define MAX_THREADS  16
+
+static const char *STATUS_NAMES[] = { "new", "run", "ready", "block" };
+
+// Too big for the user stack.
+static PsInfo table[MAX_THREADS];
+
+static void
+PrintPadded(const char *s, unsigned width)
+{
+    unsigned len = strlen(s);
+    puts2(s);
+    for (; len < width; len++) {
+        Write(" ", 1, CONSOLE_OUTPUT);
+    }
+}
+
+int
+main(int argc, char *argv[])
+{
+    int count = Ps(table, MAX_THREADS);
+    if (count > MAX_THREADS) {
+        count = MAX_THREADS;
+    }
+
+    puts2("  ID NAME            STATE  USER   SYS   SW  TLB  PF OUT  IN"
+          " RD WR CALLS\n");
+    for (int i = 0; i < count; i++) {
+        const PsInfo *p = &table[i];
+        unsigned calls = 0;
+        for (unsigned sc = 0; sc < SC_COUNT; sc++) {
+            calls += p->syscalls[sc];
+        }
+
+        putu(p->id, 4);
+        Write(" ", 1, CONSOLE_OUTPUT);
+        PrintPadded(p->name, PS_NAME_SIZE);
+        PrintPadded(0 <= p->status && p->status < 4
+                      ? STATUS_NAMES[p->status] : "?", 5);
+        putu(p->userTicks, 6);
+        putu(p->systemTicks, 6);
+        putu(p->switches, 5);
+        putu(p->tlbMisses, 5);
+        putu(p->pageFaults, 4);
+        putu(p->pagesSwappedOut, 4);
+        putu(p->pagesSwappedIn, 4);
+        putu(p->sectorsRead, 3);
+        putu(p->sectorsWritten, 3);
+        putu(calls, 6);
+        Write("\n", 1, CONSOLE_OUTPUT);
+    }
+    return 0;
+}
@@ -35,20 +35,22 @@ WriteError(const char *description, OpenFileId output)
 static unsigned
 ReadLine(char *buffer, unsigned size, OpenFileId input)
 {
-    if(buffer == NULL)
+    if(buffer == NULL || size == 0)
         return 0;
 
-    unsigned i;
+    // In line mode a single `Read` stops at the end of the line.  Raw mode
+    // (`-cr`) is left in place for the programs we run.
+    const int mode = ConsoleMode(CONSOLE_LINE);
+    int n = Read(buffer, size - 1, input);
+    ConsoleMode(mode);
 
-    for (i = 0; i < size; i++) {
-        Read(&buffer[i], 1, input);
-        if (buffer[i] == '\n') {
-            buffer[i] = '\0';
-            break;
-        }
-    }
+    if (n <= 0)
+        return 0;
+    if (buffer[n - 1] == '\n')
+        n--;
+    buffer[n] = '\0';
 
-    return i;
+    return n;
 }
 
 static int
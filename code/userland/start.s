@@ -157,6 +157,46 @@ Cd:
         .globl  Cd
         .ent    Cd
 
+        .globl  Bind
+        .ent    Bind
+Bind:
+        addiu   $2, $0, SC_BIND
+        syscall
+        j       $31
+        .end    Bind
+
+        .globl  Send
+        .ent    Send
+Send:
+        addiu   $2, $0, SC_SEND
+        syscall
+        j       $31
+        .end    Send
+
+        .globl  Receive
+        .ent    Receive
+Receive:
+        addiu   $2, $0, SC_RECEIVE
+        syscall
+        j       $31
+        .end    Receive
+
+        .globl  SharedRegion
+        .ent    SharedRegion
+SharedRegion:
+        addiu   $2, $0, SC_SHARED_REGION
+        syscall
+        j       $31
+        .end    SharedRegion
+
+        .globl  ConsoleMode
+        .ent    ConsoleMode
+ConsoleMode:
+        addiu   $2, $0, SC_CONSOLE_MODE
+        syscall
+        j       $31
+        .end    ConsoleMode
+
 /// Dummy function to keep gcc happy.
         .globl  __main
         .ent    __main
@@ -16,6 +16,9 @@
 #include "vmem/coremap.hh"
 #include "filesys/directory_entry.hh"
 #endif
+#ifdef NETWORK
+#include "network/message_port.hh"
+#endif
 
 
 /// First, set up the translation from program memory to physical memory.
@@ -27,12 +30,45 @@ AddressSpace::AddressSpace(OpenFile *executable_file,  unsigned pid)
 
     exe = new Executable(executable_file);
     ASSERT(exe->CheckMagic());
+    usage = SpaceUsage();
+    profiler = profiling ? new Profiler(exe) : nullptr;
 
     // How big is address space?
 
-    unsigned size = exe->GetSize() + USER_STACK_SIZE;
+    #ifndef DEMAND_LOADING
+    unsigned stackSize = USER_STACK_SIZE;
+    #else
+    unsigned stackSize = USER_STACK_REGION_SIZE;
+    #endif
+    unsigned size;
+    #ifndef MULTILEVEL_PAGE_TABLE
+    size = exe->GetSize() + stackSize;
       // We need to increase the size to leave room for the stack.
     numPages = DivRoundUp(size, PAGE_SIZE);
+    unsigned numMapped = numPages;
+    #ifdef NETWORK
+    // The region shared with other machines goes between the program and
+    // the stack; its pages get frames as they come from the network.
+    sharedFirst = DivRoundUp(exe->GetSize(), PAGE_SIZE);
+    sharedPages = sharedMemory != nullptr ? SHARED_MEMORY_PAGES : 0;
+    numPages += sharedPages;
+    #endif
+    #else
+    // Only the program and the stack, which goes at the very top, are
+    // mapped; everything in between is left out of the page table.
+    unsigned programPages = DivRoundUp(exe->GetSize(), PAGE_SIZE);
+    unsigned stackPages = DivRoundUp(stackSize, PAGE_SIZE);
+    numPages = USER_ADDRESS_SPACE_SIZE / PAGE_SIZE;
+    unsigned numMapped = programPages + stackPages;
+    #ifdef NETWORK
+    // The shared region goes right after the program, as above, and is
+    // mapped along with it.
+    sharedFirst = programPages;
+    sharedPages = sharedMemory != nullptr ? SHARED_MEMORY_PAGES : 0;
+    programPages += sharedPages;
+    #endif
+    ASSERT(programPages + stackPages <= numPages);
+    #endif
     size = numPages * PAGE_SIZE;
 
 
@@ -46,11 +82,11 @@ AddressSpace::AddressSpace(OpenFile *executable_file,  unsigned pid)
         ASSERT(swapFD = fileSystem->Open(nameSwapPid));
         swapMap = new Bitmap(numPages);
     #else
-    	if(numPages > paginaMapa->CountClear()) {
+    	if(numMapped > paginaMapa->CountClear()) {
             DEBUG('a', "Out of space, no swap to disk, just crashing!\n");
             paginaMapa->Print();
         }
-        ASSERT(numPages <= paginaMapa->CountClear());
+        ASSERT(numMapped <= paginaMapa->CountClear());
 
     #endif
    // swapMap = new Bitmap(numPages);
@@ -61,14 +97,31 @@ AddressSpace::AddressSpace(OpenFile *executable_file,  unsigned pid)
         char *mainMemory = machine->GetMMU()->mainMemory;
     #endif // DEMAND_LOADING
 
-    DEBUG('a', "Initializing address space, num pages %u, size %u\n",
-          numPages, size);
+    DEBUG('a', "Initializing address space, num pages %u, size %u, "
+          "mapped pages %u\n", numPages, size, numMapped);
 
     // First, set up the translation.
 
+    #ifndef MULTILEVEL_PAGE_TABLE
     pageTable = new TranslationEntry[numPages];
+    #endif
     for (unsigned i = 0; i < numPages; i++) {
+        #ifdef MULTILEVEL_PAGE_TABLE
+        if (i >= programPages && i < numPages - stackPages)
+            continue;  // Hueco entre el programa y el stack.
+        pageTable.Map(i);
+        #endif
         pageTable[i].virtualPage  = i;
+        #ifdef NETWORK
+        if (IsShared(i)) {
+            pageTable[i].physicalPage = -1;
+            pageTable[i].valid        = false;
+            pageTable[i].use          = false;
+            pageTable[i].dirty        = false;
+            pageTable[i].readOnly     = false;
+            continue;
+        }
+        #endif
 
         #ifndef DEMAND_LOADING
             int newPag = paginaMapa->Find();
@@ -101,7 +154,8 @@ AddressSpace::AddressSpace(OpenFile *executable_file,  unsigned pid)
 
 
        for(unsigned i = 0; i < numPages; i++) {
-      memset(&mainMemory[pageTable[i].physicalPage * PAGE_SIZE], 0, PAGE_SIZE); //looks fine
+      if (IsMapped(i) && pageTable[i].valid)
+        memset(&mainMemory[pageTable[i].physicalPage * PAGE_SIZE], 0, PAGE_SIZE); //looks fine
     }
 
         uint32_t codeSize = exe->GetCodeSize();
@@ -129,6 +183,12 @@ AddressSpace::AddressSpace(OpenFile *executable_file,  unsigned pid)
             }
         }
     #endif // DEMAND_LOADING
+
+    #ifdef NETWORK
+    if (sharedMemory != nullptr) {
+        sharedMemory->Attach(this);
+    }
+    #endif
 }
 
 /// Deallocate an address space.
@@ -137,20 +197,77 @@ AddressSpace::AddressSpace(OpenFile *executable_file,  unsigned pid)
 AddressSpace::~AddressSpace()
 {
 	for(unsigned i = 0; i < numPages; i++) {
+        if (!IsMapped(i))
+            continue;
+        #ifdef DEMAND_LOADING
+        if (IsZeroPage(i))
+            continue;
+        #endif
+        #ifdef NETWORK
+        if (IsShared(i))
+            continue;  // Its frame belongs to the shared memory.
+        #endif
         if (pageTable[i].valid)
             paginaMapa->Clear(pageTable[i].physicalPage);
 	}
 
+    #ifndef MULTILEVEL_PAGE_TABLE
     delete [] pageTable;
+    #endif
     #ifdef SWAP
   //  fileSystem->Remove(nameSwapPid);
     delete [] nameSwapPid;
     delete swapMap;
     #endif
 
+	delete profiler;
 	delete exe;
+    #ifdef NETWORK
+    MessagePort::Unbind(this);  // The mail boxes it bound.
+    if (sharedMemory != nullptr) {
+        sharedMemory->Detach(this);
+    }
+    #endif
 }
 
+bool
+AddressSpace::IsMapped(unsigned vpn) const
+{
+    #ifdef MULTILEVEL_PAGE_TABLE
+    return pageTable.Lookup(vpn) != nullptr;
+    #else
+    return vpn < numPages;
+    #endif
+}
+
+#ifdef NETWORK
+bool
+AddressSpace::IsShared(unsigned vpn) const
+{
+    return vpn >= sharedFirst && vpn < sharedFirst + sharedPages;
+}
+
+unsigned
+AddressSpace::GetSharedAddress() const
+{
+    return sharedPages > 0 ? sharedFirst * PAGE_SIZE : 0;
+}
+
+void
+AddressSpace::LoadSharedPage(unsigned vpn, bool writing)
+{
+    ASSERT(IsShared(vpn));
+    sharedMemory->Fault(vpn - sharedFirst, writing);
+}
+
+TranslationEntry *
+AddressSpace::GetSharedEntry(unsigned page)
+{
+    ASSERT(page < sharedPages);
+    return &pageTable[sharedFirst + page];
+}
+#endif
+
 /// Set the initial values for the user-level register set.
 ///
 /// We write these directly into the “machine” registers, so that we can
@@ -209,7 +326,11 @@ void
 AddressSpace::RestoreState()
 {
     #ifndef USE_TLB
+    #ifdef MULTILEVEL_PAGE_TABLE
+    machine->GetMMU()->pageTable     = &pageTable;
+    #else
     machine->GetMMU()->pageTable     = pageTable;
+    #endif
     machine->GetMMU()->pageTableSize = numPages;
     #else
     DEBUG('e', "Cambio de contexto TLB NO CONSISTENTE...\n");
@@ -237,22 +358,26 @@ AddressSpace::EscribirFrameenSwap(unsigned frame){
 
   for (unsigned i = 0; i < TLB_SIZE; i++) {
     if (tlb[i].physicalPage == frame && tlb[i].valid) {
-      pageTable[vpn] = tlb[i];
+      space->pageTable[vpn] = tlb[i];
       tlb[i].valid = false;
       break;
     }
   }
 
-  if (pageTable[vpn].dirty) { // SI LA PAGINA ESTA DIRTY ANTES SOBREESCRIBIR CON MARK LA MANDO A MEMORIA AL ARCHIVO SWWAPPPPPPPPP GIL, SI YA ESTA LIMPIA LA PISO TRANQUI
+  if (space->pageTable[vpn].dirty) { // SI LA PAGINA ESTA DIRTY ANTES SOBREESCRIBIR CON MARK LA MANDO A MEMORIA AL ARCHIVO SWWAPPPPPPPPP GIL, SI YA ESTA LIMPIA LA PISO TRANQUI
     DEBUG('e', "Pagina Victima Sucia, hay que lavarla y mandarla a escribir en mem...\n");
     char *mainMemory = machine->GetMMU()->mainMemory;
     space->swapFD->WriteAt(&mainMemory[frame * PAGE_SIZE], PAGE_SIZE, vpn * PAGE_SIZE);
     space->swapMap->Mark(vpn);
     stats->numPageToSwap++;
+    space->usage.pagesSwappedOut++;
+    if (tracer != nullptr) {
+        tracer->Record(TRACE_SWAP_OUT, vpn, frame);
+    }
   }
 
-  pageTable[vpn].dirty = false;
-  pageTable[vpn].valid = false;
+  space->pageTable[vpn].dirty = false;
+  space->pageTable[vpn].valid = false;
 
   return;
 }
@@ -260,7 +385,10 @@ AddressSpace::EscribirFrameenSwap(unsigned frame){
 
 int
 AddressSpace::SustitucionEnSwapDeMarcoVictima( unsigned vpn){ ///Elegimos el marco victima de reemplazo, y meto la pagina que necesito en el y le asigno al marco su nueva vpn con mark
-    int frame = PickVictim();
+    int frame;
+    do {
+        frame = PickVictim();
+    } while (paginaMapa->IsReserved(frame));  // El marco de ceros no se desaloja.
 
     EscribirFrameenSwap(frame);
     DEBUG('e', "Frame Liberado, listo para recibir su nueva pagina\n");
@@ -287,7 +415,7 @@ AddressSpace::TLBSearch(){
     if (space == nullptr)
         return nullptr;
     int vpn = paginaMapa->GetVpn(victima);
-    return &pageTable[vpn];
+    return &space->pageTable[vpn];
 }
 
 
@@ -348,12 +476,74 @@ AddressSpace::PickVictim()
 
 
 
+bool
+AddressSpace::CanPrefetch(unsigned vpn)
+{
+    if (!IsMapped(vpn) || pageTable[vpn].valid)
+        return false;
+    #ifdef SWAP
+    if (swapMap->Test(vpn))
+        return false;
+    #endif
+    uint32_t codeEnd = exe->GetCodeAddr() + exe->GetCodeSize();
+    uint32_t dataEnd = exe->GetInitDataAddr() + exe->GetInitDataSize();
+    uint32_t exeEnd = codeEnd > dataEnd ? codeEnd : dataEnd;
+    return vpn * PAGE_SIZE < exeEnd;
+}
+
+bool
+AddressSpace::IsZeroPage(unsigned vpn) const
+{
+    return IsMapped(vpn) && pageTable[vpn].valid && pageTable[vpn].readOnly
+           && pageTable[vpn].physicalPage == zeroFrame;
+}
+
+void
+AddressSpace::CopyZeroPage(unsigned vpn)
+{
+    ASSERT(IsZeroPage(vpn));
+    int frame;
+    #ifndef SWAP
+        frame = paginaMapa->Find();
+        ASSERT(frame != -1);
+    #else
+        frame = paginaMapa->Find(this, vpn);
+        if (frame == -1)
+            frame = SustitucionEnSwapDeMarcoVictima(vpn);
+    #endif
+    memset(&machine->GetMMU()->mainMemory[frame * PAGE_SIZE], 0, PAGE_SIZE);
+    pageTable[vpn].physicalPage = frame;
+    pageTable[vpn].readOnly = false;
+    pageTable[vpn].dirty = false;
+    stats->numZeroPagesCopied++;
+    DEBUG('e', "Pagina %u deja el marco de ceros, nuevo marco %d\n",
+          vpn, frame);
+}
+
 void
 AddressSpace::LoadPage(unsigned vpn)
 {
     ASSERT(!pageTable[vpn].valid);
     char *mainMemory = machine->GetMMU()->mainMemory;
     int frame;
+
+    // Pages holding nothing from the executable (pure BSS and stack) that
+    // were never written out are all zeroes: share the zero frame until the
+    // first write, which raises a read-only exception.
+    bool zeroFill = !CanPrefetch(vpn);
+    #ifdef SWAP
+    zeroFill = zeroFill && !swapMap->Test(vpn);
+    #endif
+    if (zeroFill) {
+        pageTable[vpn].physicalPage = zeroFrame;
+        pageTable[vpn].valid = true;
+        pageTable[vpn].readOnly = true;
+        pageTable[vpn].use = false;
+        pageTable[vpn].dirty = false;
+        stats->numZeroPagesMapped++;
+        return;
+    }
+
     #ifndef SWAP
         frame = paginaMapa->Find(); /// EL MARCO RESULTANTE TIENE QUE SER VALIDO, Para poder cargar la pag en el
         ASSERT(frame != -1);
@@ -374,53 +564,66 @@ AddressSpace::LoadPage(unsigned vpn)
         if (swapMap->Test(vpn)){  ///Si la pagina ya esta en la swap se la lee trank palank
             swapFD->ReadAt(&mainMemory[DirPhy], PAGE_SIZE, DirVir);
             stats->numPagetoTLB++;
+            usage.pagesSwappedIn++;
+            if (tracer != nullptr) {
+                tracer->Record(TRACE_SWAP_IN, vpn, frame);
+            }
             DEBUG('f', "READAT ADDRSPACE IN\n");
+            return;
         }
     #endif // SWAP
 
-    #ifdef DEMAND_LOADING
-	    #ifdef SWAP
-        if(!swapMap->Test(vpn)){
-		#else
-		{
-		#endif // SWAP
-            DEBUG('e',"CARGANDO PAGINA POR DEMANDA\n");
-            //uint32_t codeAddr = exe->GetCodeAddr();
-            uint32_t initDataAddr = exe->GetInitDataAddr();
-            uint32_t codeSize = exe->GetCodeSize();
-            uint32_t initDataSize = exe->GetInitDataSize();
-
-            unsigned bytesCopyCODE = 0;
-            unsigned bytesCopyDATA = 0;
-
-            if (codeSize > 0 && DirVir < codeSize) { ///Copiamos el segmento de Codigo del Exe
-                DEBUG('e', "ESPACIO DE CODE COPY\n");
-                bytesCopyCODE = codeSize - DirVir;
-
-                if(PAGE_SIZE < bytesCopyCODE) ///El bloque a leer no puede ser mayor a 1 pag :,(
-                    bytesCopyCODE = PAGE_SIZE;
-
-                exe->ReadCodeBlock(&mainMemory[DirPhy], bytesCopyCODE, DirVir);
-            }
-
-            if (initDataSize > 0 && DirVir + bytesCopyCODE < initDataAddr + initDataSize && bytesCopyCODE < PAGE_SIZE ) {
-                DEBUG('e', "ESPACIO DE DATA COPY\n");
-                unsigned offset = 0;
-                if(bytesCopyCODE > 0)
-                    offset = 0;
-                else
-                    offset = DirVir - codeSize;
+    DEBUG('e',"CARGANDO PAGINA POR DEMANDA\n");
+
+    // Fault-around: grow `[first, last]` inside the aligned window that
+    // holds `vpn`, but only over pages of the executable that can get a
+    // free frame.  The victim, if any, was already chosen above.
+    unsigned first = vpn, last = vpn;
+    if (prefetchWindow > 1) {
+        unsigned budget = paginaMapa->CountClear();
+        unsigned windowStart = vpn - vpn % prefetchWindow;
+        unsigned windowEnd = windowStart + prefetchWindow;
+        while (budget > 0 && last + 1 < windowEnd && CanPrefetch(last + 1)) {
+            last++;
+            budget--;
+        }
+        while (budget > 0 && first > windowStart && CanPrefetch(first - 1)) {
+            first--;
+            budget--;
+        }
+    }
 
-                if(initDataSize - offset < PAGE_SIZE - bytesCopyCODE) ///El bloque no puede superar una 1 pag por lo tanto lo que sea ahora tiene que ser menor a PAGE ZISE menos lo que ya se leyó en COPYCODE
-                    bytesCopyDATA = initDataSize - offset ;
-                else
-                    bytesCopyDATA = PAGE_SIZE - bytesCopyCODE;
+    if (first == last) {
+        exe->ReadBlock(&mainMemory[DirPhy], PAGE_SIZE, DirVir);
+        return;
+    }
 
-                exe->ReadDataBlock(&mainMemory[DirPhy + bytesCopyCODE], bytesCopyDATA, offset);
-            }
-            ASSERT(bytesCopyCODE+bytesCopyDATA <= PAGE_SIZE);
+    // Read the whole cluster with a single request and then scatter it over
+    // the frames, which need not be contiguous.
+    unsigned clusterSize = (last - first + 1) * PAGE_SIZE;
+    char *cluster = new char [clusterSize];
+    memset(cluster, 0, clusterSize);
+    exe->ReadBlock(cluster, clusterSize, first * PAGE_SIZE);
+
+    for (unsigned page = first; page <= last; page++) {
+        if (page != vpn) {
+            #ifndef SWAP
+                frame = paginaMapa->Find();
+            #else
+                frame = paginaMapa->Find(this, page);
+            #endif
+            ASSERT(frame != -1);
+            pageTable[page].physicalPage = frame;
+            pageTable[page].valid = true;
+            pageTable[page].use = false;
+            pageTable[page].dirty = false;
+            stats->numPagesPrefetched++;
         }
-    #endif // DEMAND_LOADING
-    return;
+        memcpy(&mainMemory[pageTable[page].physicalPage * PAGE_SIZE],
+               &cluster[(page - first) * PAGE_SIZE], PAGE_SIZE);
+    }
+    DEBUG('e', "Fault-around de las paginas %u a %u\n", first, last);
+
+    delete [] cluster;
 }
 #endif // DEMAND_LOADING
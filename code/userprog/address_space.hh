@@ -16,11 +16,45 @@
 
 #include "filesys/file_system.hh"
 #include "machine/translation_entry.hh"
+#ifdef MULTILEVEL_PAGE_TABLE
+#include "machine/page_table.hh"
+#endif
 #include "executable.hh"
+#include "profiler.hh"
 #include "lib/bitmap.hh"
 
 const unsigned USER_STACK_SIZE = 2048;  ///< Increase this as necessary!
 
+#ifdef DEMAND_LOADING
+/// Default amount of pages that make up a fault-around window.  A page
+/// fault on a page of the executable also brings in its non-resident
+/// neighbours inside the same aligned window, so that a program that runs
+/// through its code sequentially does not take one trap per page.  Can be
+/// changed with the `-pw` command line option; 1 disables prefetching.
+const unsigned DEFAULT_PREFETCH_WINDOW = 8;
+
+/// With demand loading the stack is given a much larger region than
+/// `USER_STACK_SIZE`.  The region is fixed, but its pages cost nothing until
+/// touched: they are first mapped onto the shared zero frame and only get a
+/// frame of their own when written to.
+const unsigned USER_STACK_REGION_SIZE = 16 * 1024;
+#endif
+
+#ifdef MULTILEVEL_PAGE_TABLE
+/// Size of every virtual address space when using a two-level page table.
+/// The program is mapped at the bottom and the stack at the top; the hole
+/// in between is never mapped and costs no page table memory.
+const unsigned USER_ADDRESS_SPACE_SIZE = 1024 * 1024;
+#endif
+
+
+/// Paging done for an address space, as reported by the `Ps` system call.
+struct SpaceUsage {
+    unsigned long tlbMisses;
+    unsigned long pageFaults;       ///< Pages loaded on demand.
+    unsigned long pagesSwappedOut;  ///< Dirty pages written to swap.
+    unsigned long pagesSwappedIn;
+};
 
 class AddressSpace {
 public:
@@ -43,15 +77,48 @@ public:
     /// Initialize user-level CPU registers, before jumping to user code.
     void InitRegisters();
 
+    /// Is `vpn` part of the address space?  Pages in the hole between the
+    /// program and the stack are not.
+    bool IsMapped(unsigned vpn) const;
+
     /// Save/restore address space-specific info on a context switch.
 
     void SaveState();
     void RestoreState();
 
     #ifdef DEMAND_LOADING
+    /// Bring page `vpn` into memory, from the swap file or from the
+    /// executable.  Executable pages are loaded together with their
+    /// neighbours inside the prefetch window, as long as there are free
+    /// frames for them; prefetching never evicts anybody.
     void LoadPage(unsigned vpn);
+
+    /// Is `vpn` mapped read-only onto the shared zero frame?
+    bool IsZeroPage(unsigned vpn) const;
+
+    /// Give page `vpn`, currently mapped onto the zero frame, a writable
+    /// frame of its own.  Called on the first write to the page.
+    void CopyZeroPage(unsigned vpn);
     #endif
+    #ifdef NETWORK
+    /// Is `vpn` in the region backed by the distributed shared memory?
+    bool IsShared(unsigned vpn) const;
+
+    /// Address where the shared region starts; 0 without `-dsm`.
+    unsigned GetSharedAddress() const;
+
+    /// Get page `vpn` of the shared region from the machine that has it,
+    /// to read it, or to write it if `writing`.
+    void LoadSharedPage(unsigned vpn, bool writing);
+
+    /// Page table entry of page `page` of the shared region.
+    TranslationEntry *GetSharedEntry(unsigned page);
+    #endif
+    #ifdef MULTILEVEL_PAGE_TABLE
+    PageTable pageTable;
+    #else
     TranslationEntry *pageTable;
+    #endif
 
     #ifdef SWAP
     OpenFile *swapFD;
@@ -63,6 +130,12 @@ public:
     void EscribirFrameenSwap(unsigned frame);
     unsigned PickVictim();
     #endif
+
+    /// Paging done so far.
+    SpaceUsage usage;
+
+    /// Samples of the program, if profiling; null otherwise.
+    Profiler *profiler;
 private:
 
     /// Assume linear page table translation for now!
@@ -70,12 +143,25 @@ private:
 
     /// Number of pages in the virtual address space.
     unsigned numPages;
+
+    #ifdef NETWORK
+    /// First page of the shared region, and how many it has (none without
+    /// `-dsm`).
+    unsigned sharedFirst;
+    unsigned sharedPages;
+    #endif
 
   //  OpenFile* exeFile;
 
     // Executable file
     Executable *exe;
 
+    #ifdef DEMAND_LOADING
+    /// Tell whether `vpn` is a non-resident page whose contents come from
+    /// the executable, so that it can be loaded ahead of time.
+    bool CanPrefetch(unsigned vpn);
+    #endif
+
 
 };
 
@@ -28,8 +28,17 @@
 #include "threads/system.hh"
 #include "args.hh"
 
+#include <stddef.h>
 #include <stdio.h>
+#include <string.h>
 #include "address_space.hh"
+#include "machine/endianness.hh"
+#ifdef NETWORK
+#include "network/message_port.hh"
+
+static_assert(MAX_MESSAGE_SIZE == MAX_PORT_MESSAGE_SIZE,
+              "messages of user programs go through message ports");
+#endif
 
 #define MAX_LENGHT_ARG 200
 static void
@@ -45,6 +54,50 @@ IncrementPC()
     machine->WriteRegister(NEXT_PC_REG, pc);
 }
 
+/// Describe `thread` for `Ps`, in the byte order of the simulated machine.
+static void
+FillPsInfo(const Thread *thread, PsInfo *info)
+{
+    ASSERT(thread != nullptr);
+    ASSERT(info != nullptr);
+
+    memset(info, 0, sizeof *info);
+    info->id       = WordToMachine(thread->tId);
+    info->status   = WordToMachine(thread->GetStatus());
+    info->priority = WordToMachine(thread->GetPriority());
+    strncpy(info->name, thread->GetName(), PS_NAME_SIZE - 1);
+
+    const ThreadUsage &u = thread->usage;
+    info->userTicks      = WordToMachine(u.userTicks);
+    info->systemTicks    = WordToMachine(u.systemTicks);
+    info->switches       = WordToMachine(u.switches);
+    info->sectorsRead    = WordToMachine(u.sectorsRead);
+    info->sectorsWritten = WordToMachine(u.sectorsWritten);
+    for (unsigned i = 0; i < SC_COUNT; i++) {
+        info->syscalls[i] = WordToMachine(u.syscalls[i]);
+    }
+
+    if (thread->space != nullptr) {
+        const SpaceUsage &s = thread->space->usage;
+        info->tlbMisses       = WordToMachine(s.tlbMisses);
+        info->pageFaults      = WordToMachine(s.pageFaults);
+        info->pagesSwappedOut = WordToMachine(s.pagesSwappedOut);
+        info->pagesSwappedIn  = WordToMachine(s.pagesSwappedIn);
+    }
+}
+
+/// Print the profile of the running program, which is about to end.
+static void
+PrintProfile()
+{
+    AddressSpace *space = currentThread->space;
+    if (space != nullptr && space->profiler != nullptr) {
+        space->profiler->Print(currentThread->GetName());
+        delete space->profiler;
+        space->profiler = nullptr;
+    }
+}
+
 ///Rutina Para Guardar los argumentos de un hilo que hace Exec()
 void
 RutinaHiloSCExec(void* argv)
@@ -105,12 +158,18 @@ static void
 SyscallHandler(ExceptionType _et)
 {
     int scid = machine->ReadRegister(2);
+    unsigned long start = stats->totalTicks;
+    if (0 <= scid && scid < SC_COUNT) {
+        currentThread->usage.syscalls[scid]++;
+    }
 
     switch (scid) {
 
         case SC_HALT:
             DEBUG('e', "Shutdown, initiated by user program.\n");
 		    machine->WriteRegister(2,0);
+            synchConsole->Flush();  // Output still queued for the display.
+            PrintProfile();
             interrupt->Halt();
             break;
 
@@ -159,6 +218,7 @@ SyscallHandler(ExceptionType _et)
         case SC_EXIT: { ///Ej 2a. P3
             int r = machine->ReadRegister(4); //Leo R4 usrAddress
 			DEBUG('e',"Return: %d\n", r);
+            PrintProfile();
 
             currentThread->Finish(r); //Tengo que devolverle al thread si termino bien o no
             break;
@@ -240,8 +300,7 @@ SyscallHandler(ExceptionType _et)
             ReadBufferFromUser(bufferDir, buffer, sizeBytes);
 
             if(fdId == CONSOLE_OUTPUT) {
-                for(int i = 0; i < sizeBytes; i++)
-                    synchConsole->WriteCharToConsol(buffer[i]);
+                synchConsole->WriteBuffer(buffer, sizeBytes);
 
                 machine->WriteRegister(2, sizeBytes);
             } else if(!currentThread->opFD->HasKey(fdId)) {
@@ -324,11 +383,12 @@ SyscallHandler(ExceptionType _et)
             if(fdId == CONSOLE_INPUT) {
                 DEBUG('e', "Reading console...\n");
 
-                for(int i = 0; i < sizeBytes; i++)
-                    buffer[i] = synchConsole->ReadCharFromConsole();
+                // In line mode, returns as soon as a line is complete.
+                int bytesRead = synchConsole->Read(buffer, sizeBytes);
 
-                WriteBufferToUser(buffer, bufferDir, sizeBytes);
-                machine->WriteRegister(2, sizeBytes);
+                if(bytesRead > 0)
+                    WriteBufferToUser(buffer, bufferDir, bytesRead);
+                machine->WriteRegister(2, bytesRead);
             } else if(!currentThread->opFD->HasKey(fdId)) {
                 DEBUG('e', "Read in unopen file\n");
                 machine->WriteRegister(2, 0);
@@ -518,6 +578,12 @@ SyscallHandler(ExceptionType _et)
 	        machine->WriteRegister(2, hilo->tId);
 	        break;
         }
+        case SC_YIELD: {
+            DEBUG('e', "Thread \"%s\" yields the CPU.\n",
+                  currentThread->GetName());
+            currentThread->Yield();
+            break;
+        }
         case SC_JOIN: {
             int tidJoin = machine->ReadRegister(4);
             ///ERROR 1
@@ -533,8 +599,27 @@ SyscallHandler(ExceptionType _et)
             break;
         }
         case SC_PS:{ ///Ej 3. Opcional. Asumo que la Operacion que Printea el Estado del Scheduler es SCHEDULER::PRINT
-            DEBUG('e',"Scheduler State\n");
-            scheduler->Print();
+            int tableAddr = machine->ReadRegister(4);
+            int size = machine->ReadRegister(5);
+
+            if (tableAddr == 0) {
+                DEBUG('e',"Scheduler State\n");
+                scheduler->Print();
+            }
+
+            scheduler->ChargeTime();  // Bring our own ticks up to date.
+            int count = 0;
+            for (Thread *t = Thread::FirstThread(); t != nullptr;
+                 t = t->allLink.next, count++) {
+                if (tableAddr != 0 && count < size) {
+                    PsInfo info;
+                    FillPsInfo(t, &info);
+                    WriteBufferToUser((const char *) &info,
+                                      tableAddr + count * sizeof info,
+                                      sizeof info);
+                }
+            }
+            machine->WriteRegister(2, count);
             break;
         }
         case SC_LS: {
@@ -586,12 +671,128 @@ SyscallHandler(ExceptionType _et)
 
             break;
         }
+
+        case SC_BIND: {
+            MailAddress address = -1;
+            #ifdef NETWORK
+            int box = machine->ReadRegister(4);
+            if (MessagePort::Bind(box, currentThread->space) != nullptr) {
+                address = MAIL_ADDRESS(postOffice->GetAddress(), box);
+            } else {
+                DEBUG('e', "Error: mail box %d does not exist or is taken.\n",
+                      box);
+            }
+            #endif
+            machine->WriteRegister(2, address);
+            break;
+        }
+
+        case SC_SEND: {
+            int result = -1;
+            #ifdef NETWORK
+            int bufferAddr = machine->ReadRegister(4);
+            int size       = machine->ReadRegister(5);
+            int box        = machine->ReadRegister(6);
+            MailAddress to = machine->ReadRegister(7);
+            MessagePort *port = MessagePort::Lookup(box, currentThread->space);
+            if (port == nullptr) {
+                DEBUG('e', "Error: mail box %d is not bound.\n", box);
+            } else if (bufferAddr == 0 || size < 0
+                         || size > MAX_MESSAGE_SIZE) {
+                DEBUG('e', "Error: bad message buffer.\n");
+            } else if (to < 0
+                         || MAIL_BOX(to) >= postOffice->GetNumBoxes()) {
+                DEBUG('e', "Error: no mail box at address %d.\n", to);
+            } else {
+                char data[MAX_MESSAGE_SIZE];
+                if (size > 0) {
+                    ReadPagesFromUser(bufferAddr, data, size);
+                }
+                port->Send(MAIL_MACHINE(to), MAIL_BOX(to), data, size);
+                result = size;
+            }
+            #endif
+            machine->WriteRegister(2, result);
+            break;
+        }
+
+        case SC_RECEIVE: {
+            int result = -1;
+            #ifdef NETWORK
+            int messageAddr = machine->ReadRegister(4);
+            int box         = machine->ReadRegister(5);
+            int timeout     = machine->ReadRegister(6);
+            MessagePort *port = MessagePort::Lookup(box, currentThread->space);
+            if (port == nullptr) {
+                DEBUG('e', "Error: mail box %d is not bound.\n", box);
+            } else if (messageAddr == 0) {
+                DEBUG('e', "Error: message is null.\n");
+            } else {
+                Message message;
+                NetworkAddress fromAddr;
+                MailBoxAddress fromBox;
+                result = port->Receive(message.data, timeout,
+                                       &fromAddr, &fromBox);
+                if (result >= 0) {
+                    message.from   = WordToMachine(MAIL_ADDRESS(fromAddr,
+                                                                fromBox));
+                    message.length = WordToMachine(result);
+                    WritePagesToUser((const char *) &message, messageAddr,
+                                     offsetof(Message, data) + result);
+                }
+            }
+            #endif
+            machine->WriteRegister(2, result);
+            break;
+        }
+
+        case SC_SHARED_REGION: {
+            int address = 0;
+            #ifdef NETWORK
+            int machineAddr  = machine->ReadRegister(4);
+            int machinesAddr = machine->ReadRegister(5);
+            if (sharedMemory == nullptr) {
+                DEBUG('e', "Error: no shared memory without -dsm.\n");
+            } else {
+                address = currentThread->space->GetSharedAddress();
+                if (machineAddr != 0) {
+                    int word = WordToMachine(postOffice->GetAddress());
+                    WriteBufferToUser((const char *) &word, machineAddr,
+                                      sizeof word);
+                }
+                if (machinesAddr != 0) {
+                    int word = WordToMachine(sharedMemory->GetMachines());
+                    WriteBufferToUser((const char *) &word, machinesAddr,
+                                      sizeof word);
+                }
+            }
+            #endif
+            machine->WriteRegister(2, address);
+            break;
+        }
+
+        case SC_CONSOLE_MODE: {
+            int mode = machine->ReadRegister(4);
+            int old = synchConsole->IsLineMode() ? CONSOLE_LINE : CONSOLE_RAW;
+            if (mode == CONSOLE_RAW || mode == CONSOLE_LINE) {
+                synchConsole->SetLineMode(mode == CONSOLE_LINE);
+            } else if (mode != CONSOLE_QUERY) {
+                DEBUG('e', "Error: unknown console mode %d.\n", mode);
+                old = -1;
+            }
+            machine->WriteRegister(2, old);
+            break;
+        }
+
         default:
             fprintf(stderr, "Unexpected system call: id %d.\n", scid);
             ASSERT(false);
 
     }
 
+    if (tracer != nullptr) {
+        tracer->RecordSince(TRACE_SYSCALL, start, scid);
+    }
     IncrementPC();
 }
 
@@ -599,13 +800,28 @@ SyscallHandler(ExceptionType _et)
 static void
 PageFaultExeption(ExceptionType pfE){
   #ifdef USE_TLB
-    unsigned vpn = machine->ReadRegister(BAD_VADDR_REG) / PAGE_SIZE;
+    unsigned badVAddr = machine->ReadRegister(BAD_VADDR_REG);
+    unsigned vpn = badVAddr / PAGE_SIZE;
+    currentThread->space->usage.tlbMisses++;
+    if (tracer != nullptr) {
+        tracer->Record(TRACE_TLB_MISS, badVAddr);
+    }
+    if (!currentThread->space->IsMapped(vpn)) {
+        DEBUG('e', "Pagina %u fuera del espacio de direcciones\n", vpn);
+        DefaultHandler(ADDRESS_ERROR_EXCEPTION);
+        return;
+    }
     TranslationEntry *pageTableentry = &(currentThread->space->pageTable[vpn]);
 
     #ifdef DEMAND_LOADING
     if(!pageTableentry->valid){
     DEBUG('e', "Pagina no cargada en Memoria, yendo a cargarla\n");
+    unsigned long start = stats->totalTicks;
+    currentThread->space->usage.pageFaults++;
     currentThread->space->LoadPage(vpn);
+    if (tracer != nullptr) {
+        tracer->RecordSince(TRACE_PAGE_FAULT, start, vpn);
+    }
 }
     #endif
 
@@ -621,6 +837,18 @@ PageFaultExeption(ExceptionType pfE){
     index %= TLB_SIZE;
     stats->numPageFaults++;
     #else
+    #ifdef NETWORK
+    unsigned vpn = machine->ReadRegister(BAD_VADDR_REG) / PAGE_SIZE;
+    if (currentThread->space->IsShared(vpn)) {
+        // Reads and writes both fault on a page of the shared region that
+        // this machine does not have; a write faults once more if it only
+        // got a copy to read.
+        currentThread->space->usage.pageFaults++;
+        currentThread->space->LoadSharedPage(vpn, false);
+        stats->numPageFaults++;
+        return;
+    }
+    #endif
     DefaultHandler(pfE);
     #endif // USE_TLB
 }
@@ -629,6 +857,32 @@ PageFaultExeption(ExceptionType pfE){
 static void
 ReadOnlyException(ExceptionType _et)
 {
+    #if defined(DEMAND_LOADING) || defined(NETWORK)
+    unsigned vpn = machine->ReadRegister(BAD_VADDR_REG) / PAGE_SIZE;
+    #endif
+    #ifdef NETWORK
+    if (currentThread->space->IsShared(vpn)) {
+        // First write to a copy of a shared page that may only be read.
+        currentThread->space->LoadSharedPage(vpn, true);
+        return;
+    }
+    #endif
+    #ifdef DEMAND_LOADING
+    if (currentThread->space->IsZeroPage(vpn)) {
+        // First write to a page shared with the zero frame: give it a frame
+        // of its own and let the instruction be retried.
+        currentThread->space->CopyZeroPage(vpn);
+        #ifdef USE_TLB
+        TranslationEntry *tlb = machine->GetMMU()->tlb;
+        for (unsigned i = 0; i < TLB_SIZE; i++) {
+            if (tlb[i].valid && tlb[i].virtualPage == vpn) {
+                tlb[i] = currentThread->space->pageTable[vpn];
+            }
+        }
+        #endif
+        return;
+    }
+    #endif
     DEBUG('e', "Read from a page Only Read permission\n");
     ASSERT(false);
     return;
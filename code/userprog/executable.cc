@@ -109,3 +109,78 @@ Executable::ReadDataBlock(char *dest, uint32_t size, uint32_t offset)
 
     return file->ReadAt(dest, size, header.initData.inFileAddr + offset);
 }
+
+int
+Executable::ReadBlock(char *dest, uint32_t size, uint32_t virtualAddr)
+{
+    ASSERT(dest != nullptr);
+    ASSERT(size != 0);
+
+    const noffSegment *segments[] = { &header.code, &header.initData };
+    const unsigned NUM_SEGMENTS = sizeof segments / sizeof *segments;
+    uint32_t end = virtualAddr + size;
+    int numRead = 0;
+
+    for (unsigned i = 0; i < NUM_SEGMENTS; i++) {
+        const noffSegment *seg = segments[i];
+        uint32_t from = seg->virtualAddr > virtualAddr
+                        ? seg->virtualAddr : virtualAddr;
+        uint32_t to = seg->virtualAddr + seg->size < end
+                      ? seg->virtualAddr + seg->size : end;
+        if (seg->size == 0 || from >= to) {
+            continue;
+        }
+        uint32_t fileAddr = seg->inFileAddr + (from - seg->virtualAddr);
+
+        // Merge with the following segment when it starts right where this
+        // one ends, both in the address space and in the file.
+        while (i + 1 < NUM_SEGMENTS && to == seg->virtualAddr + seg->size) {
+            const noffSegment *next = segments[i + 1];
+            if (next->size == 0 || next->virtualAddr != to
+                  || next->inFileAddr != seg->inFileAddr + seg->size) {
+                break;
+            }
+            to = next->virtualAddr + next->size < end
+                 ? next->virtualAddr + next->size : end;
+            seg = next;
+            i++;
+        }
+
+        numRead += file->ReadAt(dest + (from - virtualAddr), to - from,
+                                fileAddr);
+    }
+    return numRead;
+}
+
+noffSymbol *
+Executable::ReadSymbols(unsigned *numSymbols)
+{
+    ASSERT(numSymbols != nullptr);
+
+    *numSymbols = 0;
+    unsigned length = file->Length();
+    if (length < sizeof header + sizeof (noffSymbolTrailer)) {
+        return nullptr;
+    }
+
+    noffSymbolTrailer trailer;
+    unsigned trailerAddr = length - sizeof trailer;
+    file->ReadAt((char *) &trailer, sizeof trailer, trailerAddr);
+    if (WordToHost(trailer.magic) != NOFF_SYMBOLS_MAGIC) {
+        return nullptr;
+    }
+    unsigned n = WordToHost(trailer.numSymbols);
+    if (n == 0 || n > (trailerAddr - sizeof header) / sizeof (noffSymbol)) {
+        return nullptr;
+    }
+
+    noffSymbol *symbols = new noffSymbol [n];
+    file->ReadAt((char *) symbols, n * sizeof *symbols,
+                 trailerAddr - n * sizeof *symbols);
+    for (unsigned i = 0; i < n; i++) {
+        symbols[i].address = WordToHost(symbols[i].address);
+        symbols[i].name[NOFF_SYMBOL_NAME_SIZE - 1] = '\0';
+    }
+    *numSymbols = n;
+    return symbols;
+}
@@ -63,6 +63,24 @@ public:
     int ReadCodeBlock(char *dest, uint32_t size, uint32_t offset);
     int ReadDataBlock(char *dest, uint32_t size, uint32_t offset);
 
+    /// Read every byte of the code and initialized data segments that falls
+    /// inside the virtual range `[virtualAddr, virtualAddr + size)`.
+    ///
+    /// Bytes of `dest` that do not belong to either segment are left
+    /// untouched, so the caller is expected to zero it beforehand.  When
+    /// both segments are laid out back to back, in memory and in the file,
+    /// a range that spans them is fetched with a single file request.
+    ///
+    /// Returns the amount of bytes read.
+    int ReadBlock(char *dest, uint32_t size, uint32_t virtualAddr);
+
+    /// Read the table of procedures that `coff2noff` may have left at the
+    /// end of the file, sorted by address.
+    ///
+    /// Returns an array to be deleted by the caller, and its length in
+    /// `numSymbols`; or null if the file has no symbols.
+    noffSymbol *ReadSymbols(unsigned *numSymbols);
+
 private:
     OpenFile *file;
     noffHeader header;
@@ -0,0 +1,308 @@
+/// Copyright (c) 2016-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "profiler.hh"
+#include "address_space.hh"
+#include "machine/endianness.hh"
+#include "threads/system.hh"
+
+#include <stdio.h>
+#include <string.h>
+
+
+/// Instructions of a procedure prologue.  Both have `$sp` as base register
+/// and a signed 16-bit immediate.
+static const unsigned ADDIU_SP_SP = 0x27BD0000;  ///< `addiu $sp, $sp, imm`.
+static const unsigned SW_RA_SP    = 0xAFBF0000;  ///< `sw $ra, imm($sp)`.
+static const unsigned JR_RA       = 0x03E00008;  ///< `jr $ra`.
+
+/// Instructions looked at after the program counter for an epilogue.
+static const unsigned EPILOGUE_SIZE = 4;
+
+Profiler::Profiler(Executable *exe)
+{
+    ASSERT(exe != nullptr);
+
+    symbols  = exe->ReadSymbols(&numSymbols);
+    codeAddr = exe->GetCodeAddr();
+    codeSize = exe->GetCodeSize();
+
+    pcSamples = new unsigned [codeSize / 4 + 1];
+    memset(pcSamples, 0, (codeSize / 4 + 1) * sizeof *pcSamples);
+    selfSamples  = new unsigned [numSymbols + 1];
+    totalSamples = new unsigned [numSymbols + 1];
+    arcSamples   = new unsigned [numSymbols * numSymbols + 1];
+    memset(selfSamples, 0, (numSymbols + 1) * sizeof *selfSamples);
+    memset(totalSamples, 0, (numSymbols + 1) * sizeof *totalSamples);
+    memset(arcSamples, 0,
+           (numSymbols * numSymbols + 1) * sizeof *arcSamples);
+
+    samples = 0;
+    unknown = 0;
+    cut     = 0;
+}
+
+Profiler::~Profiler()
+{
+    delete [] symbols;
+    delete [] pcSamples;
+    delete [] selfSamples;
+    delete [] totalSamples;
+    delete [] arcSamples;
+}
+
+/// Binary search for the last procedure starting at or before `address`.
+/// Addresses past the code segment belong to no procedure.
+int
+Profiler::Lookup(unsigned address) const
+{
+    if (address - codeAddr >= codeSize) {
+        return -1;
+    }
+    int low = 0, high = (int) numSymbols - 1, found = -1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        if (symbols[middle].address <= address) {
+            found = middle;
+            low   = middle + 1;
+        } else {
+            high  = middle - 1;
+        }
+    }
+    return found;
+}
+
+/// Goes straight to the page table, so that it is safe to call from an
+/// interrupt handler: a page that is not in memory just ends the walk.
+bool
+Profiler::ReadWord(const AddressSpace *space, unsigned address,
+                   unsigned *word)
+{
+    ASSERT(space != nullptr);
+    ASSERT(word != nullptr);
+
+    unsigned vpn = address / PAGE_SIZE;
+    if (address % 4 != 0 || !space->IsMapped(vpn)
+          || !space->pageTable[vpn].valid) {
+        return false;
+    }
+    unsigned physical = space->pageTable[vpn].physicalPage * PAGE_SIZE
+                        + address % PAGE_SIZE;
+    const char *mainMemory = machine->GetMMU()->mainMemory;
+    *word = WordToHost(*(const unsigned *) &mainMemory[physical]);
+    return true;
+}
+
+/// Past the epilogue's `addiu $sp, $sp, N`, up to the delay slot of its
+/// `jr $ra`, the frame is already gone and the return address is back in
+/// its register.
+bool
+Profiler::FrameIsPopped(const AddressSpace *space, unsigned pc)
+{
+    unsigned instruction;
+    if (pc >= 4 && ReadWord(space, pc - 4, &instruction)
+          && instruction == JR_RA) {
+        return true;  // In the delay slot.
+    }
+    for (unsigned i = 0; i < EPILOGUE_SIZE; i++) {
+        if (!ReadWord(space, pc + i * 4, &instruction)
+              || (instruction & 0xFFFF0000) == ADDIU_SP_SP) {
+            return false;
+        }
+        if (instruction == JR_RA) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+Profiler::Unwind(const AddressSpace *space, unsigned proc,
+                 unsigned *pc, unsigned *sp, unsigned *ra,
+                 bool innermost) const
+{
+    ASSERT(proc < numSymbols);
+    ASSERT(pc != nullptr && sp != nullptr && ra != nullptr);
+
+    unsigned frameSize = 0;
+    bool saved = false;
+    int raOffset = 0;
+    unsigned start = symbols[proc].address;
+    for (unsigned a = start;
+         a < *pc && a < start + PROFILE_PROLOGUE_SIZE * 4; a += 4) {
+        unsigned instruction;
+        if (!ReadWord(space, a, &instruction)) {
+            return false;
+        }
+        int immediate = (short) (instruction & 0xFFFF);
+        if ((instruction & 0xFFFF0000) == ADDIU_SP_SP && immediate < 0) {
+            frameSize = -immediate;
+        } else if ((instruction & 0xFFFF0000) == SW_RA_SP) {
+            raOffset = immediate;
+            saved = true;
+        }
+    }
+
+    if (innermost && (saved || frameSize > 0)
+          && FrameIsPopped(space, *pc)) {
+        saved = false;
+        frameSize = 0;
+    }
+
+    if (saved) {
+        if (!ReadWord(space, *sp + raOffset, ra)) {
+            return false;
+        }
+    } else if (!innermost) {
+        return false;  // The register was overwritten by a later call.
+    }
+    if (*ra < 8) {
+        return false;
+    }
+    *sp += frameSize;
+    *pc  = *ra - 8;  // The `jal` itself, before its delay slot.
+    return true;
+}
+
+void
+Profiler::Sample(const AddressSpace *space)
+{
+    ASSERT(space != nullptr);
+
+    unsigned pc = machine->ReadRegister(PC_REG);
+    unsigned sp = machine->ReadRegister(STACK_REG);
+    unsigned ra = machine->ReadRegister(RET_ADDR_REG);
+
+    samples++;
+    if (pc - codeAddr < codeSize) {
+        pcSamples[(pc - codeAddr) / 4]++;
+    }
+    if (numSymbols == 0) {
+        return;
+    }
+    int callee = Lookup(pc);
+    if (callee < 0) {
+        unknown++;
+        return;
+    }
+    selfSamples[callee]++;
+
+    // Procedures in the stack, to count each one once even if recursive.
+    unsigned frames[PROFILE_MAX_DEPTH];
+    unsigned depth = 0;
+    frames[depth++] = callee;
+
+    // The program starts at address 0, so whatever is there was called by
+    // nobody.
+    while (symbols[callee].address != 0) {
+        if (depth == PROFILE_MAX_DEPTH
+              || !Unwind(space, callee, &pc, &sp, &ra, depth == 1)) {
+            cut++;
+            break;
+        }
+        int caller = Lookup(pc);
+        if (caller < 0) {
+            cut++;
+            break;
+        }
+        arcSamples[caller * numSymbols + callee]++;
+        frames[depth++] = caller;
+        callee = caller;
+    }
+
+    for (unsigned i = 0; i < depth; i++) {
+        bool repeated = false;
+        for (unsigned j = 0; j < i; j++) {
+            repeated = repeated || frames[j] == frames[i];
+        }
+        if (!repeated) {
+            totalSamples[frames[i]]++;
+        }
+    }
+}
+
+void
+Profiler::Print(const char *name) const
+{
+    ASSERT(name != nullptr);
+
+    printf("Profile of %s: %lu samples", name, samples);
+    if (unknown > 0 || cut > 0) {
+        printf(" (%lu outside procedures, %lu stacks cut short)",
+               unknown, cut);
+    }
+    printf("\n");
+    if (samples == 0) {
+        return;
+    }
+
+    if (numSymbols == 0) {
+        printf("No symbols in the executable; only addresses are given.\n");
+    } else {
+        // Procedures by decreasing time spent in them, with their callers.
+        bool *printed = new bool [numSymbols];
+        memset(printed, 0, numSymbols * sizeof *printed);
+        printf("   self%%    self   total  procedure\n");
+        for (;;) {
+            int best = -1;
+            for (unsigned i = 0; i < numSymbols; i++) {
+                if (!printed[i] && totalSamples[i] > 0
+                      && (best < 0
+                          || selfSamples[i] > selfSamples[best]
+                          || (selfSamples[i] == selfSamples[best]
+                              && totalSamples[i] > totalSamples[best]))) {
+                    best = i;
+                }
+            }
+            if (best < 0) {
+                break;
+            }
+            printed[best] = true;
+            printf("  %5.1f%% %7u %7u  %s\n",
+                   100.0 * selfSamples[best] / samples,
+                   selfSamples[best], totalSamples[best],
+                   symbols[best].name);
+            for (unsigned caller = 0; caller < numSymbols; caller++) {
+                unsigned n = arcSamples[caller * numSymbols + best];
+                if (n > 0) {
+                    printf("                 %7u    called from %s\n",
+                           n, symbols[caller].name);
+                }
+            }
+        }
+        delete [] printed;
+    }
+
+    // Instructions sampled, the most sampled first.
+    unsigned *hot = new unsigned [codeSize / 4 + 1];
+    unsigned numHot = 0;
+    for (unsigned i = 0; i < codeSize / 4; i++) {
+        if (pcSamples[i] > 0) {
+            hot[numHot++] = i;
+        }
+    }
+    printf("Hottest instructions:\n");
+    for (unsigned k = 0; k < numHot && k < PROFILE_HOT_INSTRUCTIONS; k++) {
+        unsigned best = k;
+        for (unsigned i = k + 1; i < numHot; i++) {
+            if (pcSamples[hot[i]] > pcSamples[hot[best]]) {
+                best = i;
+            }
+        }
+        unsigned index = hot[best];
+        hot[best] = hot[k];
+        hot[k] = index;
+
+        unsigned address = codeAddr + index * 4;
+        int proc = Lookup(address);
+        printf("  %7u  0x%08X", pcSamples[index], address);
+        if (proc >= 0) {
+            printf("  %s+0x%X", symbols[proc].name,
+                   address - symbols[proc].address);
+        }
+        printf("\n");
+    }
+    delete [] hot;
+}
@@ -0,0 +1,88 @@
+/// Sampling profiler for user programs.
+///
+/// Every time the timer interrupts a user program, its program counter is
+/// counted in a histogram, and its stack is walked to find the calls that
+/// led there.  When the program ends, the samples are printed in terms of
+/// the procedures that `coff2noff` keeps at the end of the executable:
+/// a flat profile (time spent in each procedure and in what it called), the
+/// call graph, and the hottest instructions.
+///
+/// The stack is walked the way a debugger does it without debugging
+/// information: the prologue of each procedure, from its start up to the
+/// program counter, tells how big its frame is and where it saved the
+/// return address (`addiu $sp, $sp, -N` and `sw $ra, K($sp)`).  A procedure
+/// that did not save it yet still has it in `RET_ADDR_REG`.
+///
+/// Copyright (c) 2016-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_USERPROG_PROFILER__HH
+#define NACHOS_USERPROG_PROFILER__HH
+
+
+#include "executable.hh"
+
+
+class AddressSpace;
+
+/// Calls followed up the stack in each sample.
+const unsigned PROFILE_MAX_DEPTH = 16;
+
+/// Instructions listed in the report.
+const unsigned PROFILE_HOT_INSTRUCTIONS = 10;
+
+/// Instructions looked at from the start of a procedure for its prologue.
+const unsigned PROFILE_PROLOGUE_SIZE = 32;
+
+class Profiler {
+public:
+
+    /// Get ready to profile the program in `exe`.
+    Profiler(Executable *exe);
+
+    ~Profiler();
+
+    /// Sample the program running in the machine, whose memory is `space`.
+    /// Called from the timer interrupt handler.
+    void Sample(const AddressSpace *space);
+
+    /// Print what was sampled, for the program called `name`.
+    void Print(const char *name) const;
+
+private:
+
+    /// Index of the procedure containing `address`, or -1.
+    int Lookup(unsigned address) const;
+
+    /// Read the word at `address`, if its page is in memory.
+    static bool ReadWord(const AddressSpace *space, unsigned address,
+                         unsigned *word);
+
+    /// Has the procedure stopped at `pc` already popped its frame?
+    static bool FrameIsPopped(const AddressSpace *space, unsigned pc);
+
+    /// Go from the frame of procedure `proc`, stopped at `*pc` with stack
+    /// pointer `*sp`, to the frame of its caller.  `*ra` is the return
+    /// address register, only meaningful for the innermost frame.
+    bool Unwind(const AddressSpace *space, unsigned proc,
+                unsigned *pc, unsigned *sp, unsigned *ra,
+                bool innermost) const;
+
+    noffSymbol *symbols;
+    unsigned numSymbols;
+    unsigned codeAddr;
+    unsigned codeSize;
+
+    unsigned *pcSamples;     ///< Samples per instruction of the code.
+    unsigned *selfSamples;   ///< Samples per procedure.
+    unsigned *totalSamples;  ///< Samples with the procedure in the stack.
+    unsigned *arcSamples;    ///< Samples per `caller * numSymbols + callee`.
+
+    unsigned long samples;
+    unsigned long unknown;   ///< Samples outside every procedure.
+    unsigned long cut;       ///< Stack walks that could not finish.
+};
+
+
+#endif
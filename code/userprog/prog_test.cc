@@ -10,7 +10,9 @@
 
 
 #include "address_space.hh"
+#include "synch_console.hh"
 #include "machine/console.hh"
+#include "threads/benchmark.hh"
 #include "threads/semaphore.hh"
 #include "threads/system.hh"
 
@@ -95,3 +97,32 @@ ConsoleTest(const char *in, const char *out)
         }
     }
 }
+
+/// Measure how fast a character stream goes through `SynchConsole`: copy
+/// all of `in` to `out`, one character at a time, the way `Read` and
+/// `Write` system calls do.
+///
+/// Reports simulated ticks and host nanoseconds per character.
+void
+ConsoleBenchmark(const char *in, const char *out)
+{
+    ASSERT(in != nullptr);
+    ASSERT(out != nullptr);
+
+    SynchConsole *sc = new SynchConsole(in, out);
+    unsigned long chars = 0;
+    Benchmark bench("Console benchmark");
+
+    for (;;) {
+        char c = sc->ReadCharFromConsole();
+        if (c == (char) EOF && sc->AtEndOfInput()) {
+            break;
+        }
+        sc->WriteCharToConsol(c);
+        chars++;
+    }
+    sc->Flush();
+
+    bench.Report(chars, "char");
+    delete sc;
+}
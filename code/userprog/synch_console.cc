@@ -3,15 +3,25 @@
 /// limitation of liability and disclaimer of warranty provisions.
 
 #include "synch_console.hh"
+#include "threads/system.hh"
+#include <stdio.h>
 #include <stdlib.h>
 
 
 SynchConsole::SynchConsole(const char* in,const char* out){
     rLock = new Lock("Read Lock");
     rSem = new Semaphore("Read Sem",0);
+    readerWaiting = false;
+    readStalled = false;
+    readEOF = false;
+    lineMode = true;
 
     wLock = new Lock("Write Lock");
     wSem = new Semaphore("Write Sem", 0);
+    writeBusy = false;
+    writerWaiting = false;
+    flushSem = new Semaphore("Flush Sem", 0);
+    flushWaiting = false;
     console = new Console(in,out,ReadWait,WriteOK,this);
 }
 
@@ -20,28 +30,173 @@ SynchConsole::~SynchConsole(){
     delete rSem;
     delete wLock;
     delete wSem;
+    delete flushSem;
     delete console;
 }
 
 void SynchConsole:: WriteCharToConsol(char c){
+    WriteBuffer(&c, 1);
+}
+
+void SynchConsole::WriteBuffer(const char* buffer, unsigned size){
+    ASSERT(buffer != nullptr || size == 0);
+
     wLock ->Acquire();
-    console->PutChar(c);
-    wSem->P();
+    unsigned written = 0;
+    while (written < size) {
+        unsigned pushed = writeRing.PushN(buffer + written, size - written);
+        written += pushed;
+        // If the device is idle, nobody is going to take the characters out
+        // of the ring but us.
+        if (pushed > 0
+              && !__atomic_exchange_n(&writeBusy, true, __ATOMIC_ACQ_REL)) {
+            WriteNext();
+        }
+        if (pushed == 0) {
+            // Full: `WriteNext` wakes us up when it takes characters out.
+            writerWaiting = true;
+            wSem->P();
+        }
+    }
     wLock->Release();
 }
 
 char SynchConsole::ReadCharFromConsole(){
+    char c;
+    return ReadBuffer(&c, 1) == 1 ? c : EOF;
+}
+
+unsigned SynchConsole::ReadBuffer(char* buffer, unsigned size){
+    ASSERT(buffer != nullptr || size == 0);
+
     rLock->Acquire();
-    rSem->P();
-    char c = console->GetChar();
+    unsigned read = 0;
+    while (read < size && WaitForInput()) {
+        read += readRing.PopN(buffer + read, size - read);
+        if (readStalled) {
+            Unstall();
+        }
+    }
     rLock->Release();
-    return c;
+    return read;
+}
+
+unsigned SynchConsole::ReadLine(char* buffer, unsigned size){
+    ASSERT(buffer != nullptr || size == 0);
+
+    rLock->Acquire();
+    unsigned read = 0;
+    while (read < size && WaitForInput()) {
+        bool taken = readRing.Pop(&buffer[read]);
+        ASSERT(taken);
+        if (readStalled) {
+            Unstall();
+        }
+        if (buffer[read++] == '\n') {
+            break;
+        }
+    }
+    rLock->Release();
+    return read;
+}
+
+unsigned SynchConsole::Read(char* buffer, unsigned size){
+    return lineMode ? ReadLine(buffer, size) : ReadBuffer(buffer, size);
+}
+
+void SynchConsole::SetLineMode(bool on){
+    lineMode = on;
+}
+
+bool SynchConsole::IsLineMode() const{
+    return lineMode;
+}
+
+bool SynchConsole::AtEndOfInput() const{
+    return readEOF && readRing.IsEmpty();
+}
+
+void SynchConsole::Flush(){
+    wLock->Acquire();
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    while (__atomic_load_n(&writeBusy, __ATOMIC_ACQUIRE)) {
+        flushWaiting = true;
+        flushSem->P();
+    }
+    interrupt->SetLevel(oldLevel);
+    wLock->Release();
+}
+
+bool SynchConsole::WaitForInput(){
+    if (!readRing.IsEmpty()) {
+        return true;
+    }
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    while (readRing.IsEmpty() && !readEOF) {
+        readerWaiting = true;
+        rSem->P();
+    }
+    interrupt->SetLevel(oldLevel);
+    return !readRing.IsEmpty();
+}
+
+void SynchConsole::Unstall(){
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    readStalled = false;
+    TakeChar();
+    interrupt->SetLevel(oldLevel);
+}
+
+/// Move the character the device has just read into the ring.
+///
+/// Runs in the read interrupt handler, or with interrupts disabled, so it
+/// is the only producer of `readRing`.
+void SynchConsole::TakeChar(){
+    if (console->AtEndOfInput()) {
+        readEOF = true;
+    } else if (readRing.IsFull()) {
+        readStalled = true;  // Stays in the device until there is room.
+        return;
+    } else {
+        readRing.Push(console->GetChar());
+    }
+    if (readerWaiting) {
+        readerWaiting = false;
+        rSem->V();
+    }
+}
+
+/// Give the device the characters waiting to be written, or mark it idle.
+///
+/// Only the holder of `writeBusy` calls this: the write interrupt handler,
+/// or the writer that found the device idle.
+void SynchConsole::WriteNext(){
+    char burst[CONSOLE_BURST_SIZE];
+    unsigned n = writeRing.PopN(burst, CONSOLE_BURST_SIZE);
+    if (n > 0) {
+        console->PutBuffer(burst, n);
+    } else {
+        __atomic_store_n(&writeBusy, false, __ATOMIC_RELEASE);
+        // A writer may have added characters after our `PopN` and seen the
+        // device busy.
+        if (!writeRing.IsEmpty()
+              && !__atomic_exchange_n(&writeBusy, true, __ATOMIC_ACQ_REL)) {
+            WriteNext();
+        } else if (flushWaiting) {
+            flushWaiting = false;
+            flushSem->V();
+        }
+    }
+    if (writerWaiting) {
+        writerWaiting = false;
+        wSem->V();
+    }
 }
 
 void SynchConsole::WriteOK(void* data){
-    ((SynchConsole*)data)->wSem->V();
+    ((SynchConsole*)data)->WriteNext();
 }
 
 void SynchConsole::ReadWait(void* data){
-    ((SynchConsole*)data)->rSem->V();
+    ((SynchConsole*)data)->TakeChar();
 }
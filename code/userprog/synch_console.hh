@@ -9,8 +9,20 @@
 #include "threads/lock.hh"
 #include "threads/semaphore.hh"
 #include "machine/console.hh"
+#include "lib/spsc_ring.hh"
 
 
+/// Characters go between the console device and the threads through
+/// lock-free rings.  The read interrupt handler takes each character off
+/// the device as soon as it arrives, and the write interrupt handler gives
+/// the device everything waiting in the ring (up to what it takes in one
+/// transfer) as soon as it is done with the last burst, so the device never
+/// waits for a thread to be scheduled.  Threads only block when the ring
+/// they need is empty (reading) or full (writing).
+///
+/// In line mode (the default, like a UNIX terminal in canonical mode),
+/// `Read` returns as soon as a whole line has arrived, instead of waiting
+/// for the buffer to fill up.
 class SynchConsole {
 public:
     SynchConsole(const char* in, const char* out);
@@ -18,18 +30,67 @@ public:
 
     char ReadCharFromConsole();
     void WriteCharToConsol(char c);
+
+    /// Write `size` characters from `buffer`, taking the lock once.
+    void WriteBuffer(const char* buffer, unsigned size);
+
+    /// Read `size` characters into `buffer`; less only if the input ends
+    /// first.  Returns how many were read.
+    unsigned ReadBuffer(char* buffer, unsigned size);
+
+    /// Read characters into `buffer` up to and including a newline, or
+    /// until `size` of them or the end of the input.  Returns how many were
+    /// read.
+    unsigned ReadLine(char* buffer, unsigned size);
+
+    /// What `Read` system calls use: `ReadLine` in line mode, `ReadBuffer`
+    /// otherwise.
+    unsigned Read(char* buffer, unsigned size);
+
+    void SetLineMode(bool on);
+    bool IsLineMode() const;
+
+    /// Has the input been read to the end?  From then on,
+    /// `ReadCharFromConsole` returns EOF and the others return 0.
+    bool AtEndOfInput() const;
+
+    /// Wait until everything written so far has reached the display.
+    void Flush();
 
 private:
 
+    static const unsigned RING_SIZE = 256;
+
     Lock* rLock;
-    Semaphore* rSem;
+    Semaphore* rSem;  ///< `V`'ed when input arrives for a waiting reader.
+    SpscRing<char, RING_SIZE> readRing;
+    bool readerWaiting;
+    bool readStalled;  ///< A character was left in the device: no room.
+    bool readEOF;  ///< Everything in the input is in `readRing`.
+    bool lineMode;
 
     Lock* wLock;
-    Semaphore* wSem;
+    Semaphore* wSem;  ///< `V`'ed when room is made for a waiting writer.
+    SpscRing<char, RING_SIZE> writeRing;
+    bool writeBusy;  ///< Is the device writing?
+    bool writerWaiting;
+    Semaphore* flushSem;  ///< `V`'ed when the device runs out of output.
+    bool flushWaiting;
 
     Console* console;
     static void WriteOK(void* data);
     static void ReadWait(void* data);
+
+    /// Wait until there is input in `readRing`.  Returns false if there
+    /// will be no more.  Called with `rLock` held.
+    bool WaitForInput();
+
+    /// Bring in the character left in the device, now that there is room.
+    void Unstall();
+
+    /// Interrupt side of the rings.
+    void TakeChar();
+    void WriteNext();
 
 };
 
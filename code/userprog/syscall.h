@@ -34,6 +34,13 @@
 #define SC_PS      16 //Ej3 Opcional. P3
 #define SC_LS   17
 #define SC_CD      18
+#define SC_BIND    19
+#define SC_SEND    20
+#define SC_RECEIVE 21
+#define SC_SHARED_REGION 22
+#define SC_CONSOLE_MODE 23
+#define SC_COUNT   24  // One more than the highest system call id.
+                           // Name new calls in `bin/trace2json.c` too.
 #ifndef IN_ASM
 
 /// The system call interface.  These are the operations the Nachos kernel
@@ -78,8 +85,34 @@ int Fork(void (*func)(void));
 /// or not.
 void Yield();
 
+/// What `Ps` tells about each thread.
+///
+/// The page faults and swapping are those of the thread's address space.
+#define PS_NAME_SIZE  16
+
+typedef struct PsInfo {
+    int id;        // As returned by `Exec`.
+    int status;    // 0: just created, 1: running, 2: ready, 3: blocked.
+    int priority;
+    char name[PS_NAME_SIZE];  // Cut if longer.
+    unsigned userTicks;
+    unsigned systemTicks;
+    unsigned switches;         // Times the thread was given the CPU.
+    unsigned tlbMisses;
+    unsigned pageFaults;       // Pages loaded on demand.
+    unsigned pagesSwappedOut;
+    unsigned pagesSwappedIn;
+    unsigned sectorsRead;
+    unsigned sectorsWritten;
+    unsigned syscalls[SC_COUNT];  // Calls made, by system call id.
+} PsInfo;
+
 ///Ej 3, P3. Ps() Syscall
-void Ps();
+///
+/// Fill `table` with information on up to `size` threads, and return how
+/// many threads there are.  With a null `table`, print the state of the
+/// scheduler instead.
+int Ps(PsInfo *table, int size);
 /// File system operations: `Create`, `Open`, `Read`, `Write`, `Close`.
 ///
 /// These functions are patterned after UNIX -- files represent both files
@@ -123,10 +156,79 @@ int Read(char *buffer, int size, OpenFileId id);
 
 /// Close the file, we are done reading and writing to it.
 int Close(OpenFileId id);
+
+/// Modes of `CONSOLE_INPUT`, for `ConsoleMode`.
+#define CONSOLE_RAW    0  // `Read` waits until the buffer is full.
+#define CONSOLE_LINE   1  // `Read` also returns at the end of a line.
+#define CONSOLE_QUERY  (-1)  // Leave the mode as it is.
+
+/// Set the mode of `CONSOLE_INPUT` to `CONSOLE_RAW` or `CONSOLE_LINE`, or
+/// only ask for it with `CONSOLE_QUERY`.  Nachos starts in line mode, or in
+/// raw mode with `-cr`.  Return the mode before the call, or -1 if `mode`
+/// is not one of these.
+int ConsoleMode(int mode);
 ///
 void Ls(char *buffer);
 int Cd(char *dirname);
 ///
+
+/// Network operations: `Bind`, `Send`, `Receive`.
+///
+/// Messages go between mail boxes of the Nachos machines that share a
+/// directory, each started with its own `-id`.  A message may be lost on
+/// the way, but it is never corrupted or cut; only kernels built with
+/// `NETWORK` support these calls, the rest return -1.
+
+/// Where a message goes: a mail box of a machine.
+typedef int MailAddress;
+
+#define MAIL_ADDRESS(machine, box)  ((machine) << 8 | (box))
+#define MAIL_MACHINE(address)       ((address) >> 8)
+#define MAIL_BOX(address)           ((address) & 0xFF)
+
+/// Data in a message, at most: a page.
+#define MAX_MESSAGE_SIZE  128
+
+/// Timeout for `Receive` that waits as long as it takes.
+#define RECEIVE_FOREVER  (-1)
+
+/// A message, as `Receive` gives it.
+typedef struct Message {
+    MailAddress from;  // Where to send a reply.
+    int length;
+    char data[MAX_MESSAGE_SIZE];
+} Message;
+
+/// Claim mail box `box` of this machine for the calling program, to send
+/// from and receive at, until it exits.  Return the address of the box, or
+/// -1 if there is no such box or it is taken (with `-dsm`, the kernel takes
+/// boxes 8 and 9 for the shared memory).
+MailAddress Bind(int box);
+
+/// Send `size` bytes of `buffer`, at most `MAX_MESSAGE_SIZE`, from the
+/// bound mail box `box` to `to`.  Return `size`, or -1 on error.
+int Send(const char *buffer, int size, int box, MailAddress to);
+
+/// Wait up to `timeout` ticks (not at all if 0, forever if
+/// `RECEIVE_FOREVER`) for a message in the bound mail box `box`, and put
+/// it in `message`.  Return its length, or -1 if none came.
+int Receive(Message *message, int box, int timeout);
+
+/// Distributed shared memory: `SharedRegion`.
+///
+/// A Nachos machine started with `-dsm <machines>` gives every program a
+/// region of `SHARED_MEMORY_SIZE` bytes that machines 0 to `machines - 1`
+/// see alike: what a program writes there, programs on the other machines
+/// read.  Pages move between the machines as they are used, so writing to
+/// the same page from several machines at once is slow.
+
+/// Bytes in the shared region.
+#define SHARED_MEMORY_SIZE  2048
+
+/// Return the address of the shared region, or null if Nachos was not
+/// started with `-dsm`.  Unless they are null, `machine` gets the number
+/// of this machine, and `machines` how many share the region.
+char *SharedRegion(int *machine, int *machines);
 #endif
 
 
@@ -4,9 +4,12 @@
 
 
 #include "transfer.hh"
+#include "address_space.hh"
 #include "lib/utility.hh"
 #include "threads/system.hh"
 
+#include <string.h>
+
 //En si los Terminadores \0 no me importa mucho llevarlos a mem. Pero cuando necesito traer nbytes de la memoria o una string de la memoria se lo pongo para el usuario
 
 
@@ -89,4 +92,61 @@ void WriteStringToUser(const char *string, int userAddress)
         count++;
     } while ((string[count]) != '\0' );
 
-}
+}
+
+/// Where the byte at `userAddress` is in main memory.  It is read (or
+/// written with `value`) first, the same way as by the copies a byte at a
+/// time, so that its page is brought in and marked as used (or dirty).
+static char *
+UserByte(int userAddress, bool writing, char value)
+{
+    int temp, i;
+    for (i = 0; i < PASADAS_DE_LECTURA; i++) {
+        if (writing ? machine->WriteMem(userAddress, 1, value)
+                    : machine->ReadMem(userAddress, 1, &temp)) {
+            break;
+        }
+    }
+    ASSERT(i < PASADAS_DE_LECTURA);
+
+    unsigned physicalPage =
+        currentThread->space->pageTable[userAddress / PAGE_SIZE].physicalPage;
+    return &machine->GetMMU()->mainMemory[physicalPage * PAGE_SIZE
+                                          + userAddress % PAGE_SIZE];
+}
+
+void ReadPagesFromUser(int userAddress, char *outBuffer,
+                       unsigned byteCount)
+{
+    ASSERT(userAddress != 0);
+    ASSERT(outBuffer != nullptr);
+
+    while (byteCount > 0) {
+        unsigned chunk = PAGE_SIZE - userAddress % PAGE_SIZE;
+        if (chunk > byteCount) {
+            chunk = byteCount;
+        }
+        memcpy(outBuffer, UserByte(userAddress, false, 0), chunk);
+        userAddress += chunk;
+        outBuffer   += chunk;
+        byteCount   -= chunk;
+    }
+}
+
+void WritePagesToUser(const char *buffer, int userAddress,
+                      unsigned byteCount)
+{
+    ASSERT(userAddress != 0);
+    ASSERT(buffer != nullptr);
+
+    while (byteCount > 0) {
+        unsigned chunk = PAGE_SIZE - userAddress % PAGE_SIZE;
+        if (chunk > byteCount) {
+            chunk = byteCount;
+        }
+        memcpy(UserByte(userAddress, true, *buffer), buffer, chunk);
+        userAddress += chunk;
+        buffer      += chunk;
+        byteCount   -= chunk;
+    }
+}
@@ -23,5 +23,16 @@ void WriteBufferToUser(const char *buffer, int userAddress,
 /// Copy a C string from host to virtual machine.
 void WriteStringToUser(const char *string, int userAddress);
 
+/// Copy a byte array from virtual machine to host, and back, a page at a
+/// time instead of a byte at a time.
+///
+/// For big buffers, such as network messages.
+
+void ReadPagesFromUser(int userAddress, char *outBuffer,
+                       unsigned byteCount);
+
+void WritePagesToUser(const char *buffer, int userAddress,
+                      unsigned byteCount);
+
 
 #endif
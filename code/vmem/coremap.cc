@@ -4,6 +4,7 @@ Coremap::Coremap(unsigned int nitems)
 {
 	ASSERT(nitems > 0);
 	framesMap = new Bitmap(nitems);
+	reservedMap = new Bitmap(nitems);
 	addrSpaces = new AddressSpace*[nitems];
 	vpns = new unsigned int[nitems];
 	size = nitems;
@@ -12,6 +13,7 @@ Coremap::Coremap(unsigned int nitems)
 Coremap::~Coremap()
 {
 	delete framesMap;
+	delete reservedMap;
 	delete [] addrSpaces;
 	delete [] vpns;
 }
@@ -42,7 +44,7 @@ bool
 Coremap::Test(unsigned int which) const
 {
 	ASSERT(which >= 0 && which < size);
-	if(framesMap->Test(which)) {
+	if(framesMap->Test(which) && !reservedMap->Test(which)) {
 		ASSERT(addrSpaces[which] != nullptr);
 	}
 	return framesMap->Test(which);
@@ -72,4 +74,21 @@ unsigned int
 Coremap::GetVpn(unsigned int frame)
 {
 	return Test(frame)? vpns[frame] : -1;
-}
\ No newline at end of file
+}
+
+void
+Coremap::Reserve(unsigned int which)
+{
+	ASSERT(which < size);
+	ASSERT(!framesMap->Test(which));
+	framesMap->Mark(which);
+	reservedMap->Mark(which);
+	addrSpaces[which] = nullptr;
+}
+
+bool
+Coremap::IsReserved(unsigned int which) const
+{
+	ASSERT(which < size);
+	return reservedMap->Test(which);
+}
@@ -35,10 +35,19 @@ public:
     int Find(AddressSpace *space, unsigned int vpn);
 
 	unsigned int GetVpn(unsigned int frame);
+
+    /// Take frame `which` out of the pool for good: it is never handed out
+    /// by `Find` nor belongs to any address space, so it must never be
+    /// chosen as a replacement victim either.
+    void Reserve(unsigned int which);
+
+    /// Was frame `which` taken out of the pool with `Reserve`?
+    bool IsReserved(unsigned int which) const;
     
 private:
 	unsigned int size;
 	Bitmap *framesMap;
+	Bitmap *reservedMap;
 	AddressSpace **addrSpaces;
 	unsigned int *vpns;
 };